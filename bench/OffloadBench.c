@@ -0,0 +1,137 @@
+/**
+ * @brief   Loop latency of the Linux port while slow jobs run inline or through System_Offload.
+ *
+ *          A probe task is due every tick (PORT_TICK_NS, 1 ms) and records how late it runs against its ideal time. A
+ *          producer task starts one job of BENCH_JOB_US every BENCH_JOB_TICKS ticks, either inline in the loop or on the
+ *          worker pool with a completion event. The job blocks like a flash write or a file access, define BENCH_JOB_SPIN
+ *          to burn the CPU instead (only meaningful with a free core per worker). Each mode runs for BENCH_BUDGET_MS
+ *          (default 1000) of wall time and prints one CSV row:
+ *
+ *            mode,jobs_done,jobs_rejected,probe_runs,late_avg_us,late_p99_us,late_max_us
+ **/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SystemPort.h"
+
+#ifndef PORT_OFFLOAD
+#error "The offload benchmark needs 'TICKLESS_IDLE' and an event table!"
+#endif
+#ifndef BENCH_JOB_US
+#define BENCH_JOB_US 5000
+#endif
+#ifndef BENCH_JOB_TICKS
+#define BENCH_JOB_TICKS 10
+#endif
+#define BENCH_SAMPLE_NUM 65536
+
+static int64_t budgetNs = 1000000000LL;
+static int64_t firstNs;
+static int64_t lateNs[BENCH_SAMPLE_NUM];
+static u32 sampleNum;
+static u32 doneNum, rejectNum;
+static bool offload;
+static Event *doneEvent;
+
+static inline int64_t __GetNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static u32 __SlowJob(void *arg)
+{
+    (void)arg;
+#ifdef BENCH_JOB_SPIN
+    int64_t endNs = __GetNs() + BENCH_JOB_US * 1000LL;
+    while (__GetNs() < endNs) {
+    }
+#else
+    struct timespec time = {.tv_sec = BENCH_JOB_US / 1000000, .tv_nsec = BENCH_JOB_US % 1000000 * 1000L};
+    nanosleep(&time, NULL);
+#endif
+    return 1;
+}
+
+static void __ProbeTask(u32 count, u16 state)
+{
+    (void)state;
+    int64_t nowNs = __GetNs();
+    if (count == 0) {
+        firstNs = nowNs;
+    } else if (sampleNum < BENCH_SAMPLE_NUM) {
+        int64_t late = nowNs - (firstNs + (int64_t)count * PORT_TICK_NS);
+        lateNs[sampleNum++] = late > 0 ? late : 0;
+    }
+    if (nowNs - firstNs >= budgetNs) {
+        System_EndLoop();
+    }
+}
+
+static void __ProducerTask(u32 count, u16 state)
+{
+    (void)count;
+    (void)state;
+    if (offload == false) {
+        doneNum += __SlowJob(NULL);
+    } else if (System_Offload(__SlowJob, NULL, doneEvent, 1) == false) {
+        ++rejectNum;
+    }
+}
+
+static void __DoneTask(u32 value, u16 signal)
+{
+    (void)signal;
+    doneNum += value;
+}
+
+static int __CompareNs(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void __Run(bool offloadMode)
+{
+    System_Init();
+    offload   = offloadMode;
+    sampleNum = doneNum = rejectNum = 0;
+    doneEvent = System_CreateEvent();
+    System_AddNewEventTask(__DoneTask, doneEvent, 1);
+    System_AddNewLoopTask(__ProbeTask, 1);
+    System_AddNewLoopTask(__ProducerTask, BENCH_JOB_TICKS);
+    System_Loop();
+
+    int64_t sum = 0;
+    for (u32 i = 0; i < sampleNum; ++i) {
+        sum += lateNs[i];
+    }
+    qsort(lateNs, sampleNum, sizeof(lateNs[0]), __CompareNs);
+    printf("%s,%u,%u,%u,%.1f,%.1f,%.1f\n", offloadMode ? "offload" : "inline", doneNum, rejectNum, sampleNum,
+           sampleNum ? (double)sum / sampleNum / 1000.0 : 0.0, sampleNum ? (double)lateNs[sampleNum * 99 / 100] / 1000.0 : 0.0,
+           sampleNum ? (double)lateNs[sampleNum - 1] / 1000.0 : 0.0);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *budget = getenv("BENCH_BUDGET_MS");
+    if (budget && atoi(budget) > 0) {
+        budgetNs = atoi(budget) * 1000000LL;
+    }
+    (void)argv;
+    if (System_PortInit() == false) {
+        perror("System_PortInit");
+        return 1;
+    }
+    if (argc > 1) { // any argument prints the CSV header first
+        printf("mode,jobs_done,jobs_rejected,probe_runs,late_avg_us,late_p99_us,late_max_us\n");
+    }
+    __Run(false);
+    __Run(true);
+    return 0;
+}
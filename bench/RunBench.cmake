@@ -0,0 +1,13 @@
+# cmake -DBENCH_DIR=... -DBENCH_TARGETS=a,b,... -DBENCH_BUDGET_MS=... -DBENCH_OUTPUT=... -P RunBench.cmake
+string(REPLACE "," ";" BENCH_TARGETS "${BENCH_TARGETS}")
+set(ENV{BENCH_BUDGET_MS} ${BENCH_BUDGET_MS})
+file(WRITE ${BENCH_OUTPUT} "variant,task_max_num,event_max_num,case,ops,ns_per_op,late_avg,late_p99,late_max\n")
+foreach(target ${BENCH_TARGETS})
+    message(STATUS "Running ${target}")
+    execute_process(COMMAND ${BENCH_DIR}/${target} OUTPUT_VARIABLE rows RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${target} failed: ${result}")
+    endif()
+    file(APPEND ${BENCH_OUTPUT} "${rows}")
+endforeach()
+message(STATUS "Results written to ${BENCH_OUTPUT}")
@@ -0,0 +1,111 @@
+/**
+ * @brief   Scaling of the SMP scheduler on the Linux port.
+ *
+ *          System_Loop runs on 1 to SMP_CORE_NUM threads. Every task is always due (interval 0) and burns
+ *          BENCH_WORK_NS (default 2000) of CPU per run. The "spread" case has BENCH_TASK_NUM (default 16) tasks, so
+ *          every core finds work; the "idle" case has a single task, so the other cores only poll the scheduler and
+ *          should not slow it down. Each (case, cores) pair runs for BENCH_BUDGET_MS (default 500) of wall time and
+ *          prints one CSV row, speedup is against the 1-core row of the same case:
+ *
+ *            case,cores,runs,runs_per_ms,speedup
+ **/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SystemPort.h"
+
+#ifndef SMP_CORE_NUM
+#error "The SMP benchmark needs 'SMP_CORE_NUM'!"
+#endif
+#ifndef BENCH_WORK_NS
+#define BENCH_WORK_NS 2000
+#endif
+#ifndef BENCH_TASK_NUM
+#define BENCH_TASK_NUM 16
+#endif
+
+static int64_t budgetNs = 500000000LL;
+static int64_t startNs;
+static _Atomic u32 runNum;
+
+static inline int64_t __GetNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void __WorkTask(u32 count, u16 state)
+{
+    (void)count;
+    (void)state;
+    int64_t nowNs = __GetNs(), endNs = nowNs + BENCH_WORK_NS;
+    while (nowNs < endNs) {
+        nowNs = __GetNs();
+    }
+    atomic_fetch_add_explicit(&runNum, 1, memory_order_relaxed);
+    if (nowNs - startNs >= budgetNs) {
+        System_EndLoop();
+    }
+}
+
+static void *__CoreThread(void *arg)
+{
+    (void)arg;
+    System_Loop();
+    return NULL;
+}
+
+static double __Run(const char *name, u32 taskNum, u32 coreNum, double baseRate)
+{
+    pthread_t threads[SMP_CORE_NUM];
+    System_Init();
+    for (u32 i = 0; i < taskNum; ++i) {
+        System_AddNewLoopTask(__WorkTask, 0);
+    }
+    atomic_store(&runNum, 0);
+    startNs = __GetNs();
+    u32 created = 0;
+    while (created < coreNum && pthread_create(threads + created, NULL, __CoreThread, NULL) == 0) {
+        ++created;
+    }
+    for (u32 i = 0; i < created; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    double rate = (double)atomic_load(&runNum) / ((double)(__GetNs() - startNs) / 1e6);
+    printf("%s,%u,%u,%.1f,%.2f\n", name, created, atomic_load(&runNum), rate, baseRate > 0.0 ? rate / baseRate : 1.0);
+    fflush(stdout);
+    return rate;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *budget = getenv("BENCH_BUDGET_MS");
+    if (budget && atoi(budget) > 0) {
+        budgetNs = atoi(budget) * 1000000LL;
+    }
+    (void)argv;
+    if (System_PortInit() == false) {
+        perror("System_PortInit");
+        return 1;
+    }
+    if (argc > 1) { // any argument prints the CSV header first
+        printf("case,cores,runs,runs_per_ms,speedup\n");
+    }
+    double baseRate = 0.0;
+    for (u32 cores = 1; cores <= SMP_CORE_NUM; ++cores) {
+        double rate = __Run("spread", BENCH_TASK_NUM, cores, baseRate);
+        baseRate    = cores == 1 ? rate : baseRate;
+    }
+    baseRate = 0.0;
+    for (u32 cores = 1; cores <= SMP_CORE_NUM; ++cores) {
+        double rate = __Run("idle", 1, cores, baseRate);
+        baseRate    = cores == 1 ? rate : baseRate;
+    }
+    return 0;
+}
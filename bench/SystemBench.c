@@ -0,0 +1,309 @@
+/**
+ * @brief   Host benchmark of the MinSys scheduler.
+ *
+ *          One executable is built per configuration (TASK_MAX_NUM, EVENT_MAX_NUM and the time-based
+ *          task backend are fixed at compile time). The tick is a stub advanced by the idle hook, so
+ *          the results only contain kernel overhead. Each case runs for BENCH_BUDGET_MS (default 200)
+ *          of wall time and prints one CSV row:
+ *
+ *            variant,task_max_num,event_max_num,case,ops,ns_per_op,late_avg,late_p99,late_max
+ *
+ *          The lateness columns (in ticks) are only filled by the overload cases, whose tasks advance the tick.
+ **/
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SystemCore.h"
+
+#ifndef IDLE_HOOK_FUNCITON
+#error "The benchmark advances the stub tick from the idle hook, define 'IDLE_HOOK_FUNCITON'!"
+#endif
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "default"
+#endif
+#define BENCH_LATE_NUM 65536 // lateness samples kept per overload class
+
+static u32 benchTick;
+static int64_t budgetNs = 200000000LL;
+static int64_t startNs;
+static uint64_t opNum;
+static u32 randSeed = 1;
+
+u32 System_GetCurrTick(void)
+{
+    return benchTick;
+}
+
+static inline int64_t __GetNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static inline u32 __Rand(void)
+{
+    randSeed = randSeed * 1103515245U + 12345U;
+    return randSeed >> 16;
+}
+
+static inline bool __IsBudgetSpent(void)
+{
+    return (opNum & 63) == 0 && __GetNs() - startNs >= budgetNs; // the clock is read every 64 operations
+}
+
+static void __StartCase(void)
+{
+    System_Init();
+    benchTick = 0;
+    randSeed  = 1;
+    opNum     = 0;
+}
+
+static void __Report(const char *name, int64_t elapsedNs)
+{
+    printf("%s,%u,%u,%s,%llu,%.1f,,,\n", BENCH_VARIANT, (unsigned)TASK_MAX_NUM, (unsigned)EVENT_MAX_NUM, name, (unsigned long long)opNum,
+           opNum ? (double)elapsedNs / (double)opNum : 0.0);
+    fflush(stdout);
+}
+
+static void __AdvanceTick(u32 currIdleTick, u16 lastIdleTick)
+{
+    (void)currIdleTick;
+    (void)lastIdleTick;
+    benchTick++;
+}
+
+static void __EndWhenIdle(u32 currIdleTick, u16 lastIdleTick)
+{
+    (void)currIdleTick;
+    (void)lastIdleTick;
+    System_EndLoop();
+}
+
+static inline void __Dispatched(void)
+{
+    ++opNum;
+    if (__IsBudgetSpent()) {
+        System_EndLoop();
+    }
+}
+
+/* every slot holds a periodic task with a random period of 1~16 ticks */
+static void __PeriodicTask(u32 count, u16 state)
+{
+    (void)count;
+    (void)state;
+    __Dispatched();
+}
+
+static void __BenchPeriodic(void)
+{
+    __StartCase();
+    for (u32 i = 0; i < TASK_MAX_NUM; ++i) {
+        Task *task = System_AddNewLoopTask(__PeriodicTask, 1 + __Rand() % 16);
+#ifdef TASK_PRIORITY_NUM
+        System_SetTaskPriority(task, (u8)(__Rand() % TASK_PRIORITY_NUM));
+#else
+        (void)task;
+#endif
+    }
+    System_RegisterIdleTask(__AdvanceTick);
+    startNs = __GetNs();
+    System_Loop();
+    __Report("dispatch_periodic", __GetNs() - startNs);
+}
+
+/* one-shot tasks that each create their successor, so every dispatch includes a create and a free */
+static void __OneShotTask(u32 count, u16 state)
+{
+    (void)count;
+    (void)state;
+    System_AddNewTempTask(__OneShotTask, __Rand() % 16);
+    __Dispatched();
+}
+
+static void __BenchOneShot(void)
+{
+    __StartCase();
+    for (u32 i = 0; i + 1 < TASK_MAX_NUM; ++i) {
+        System_AddNewTempTask(__OneShotTask, __Rand() % 16);
+    }
+    System_RegisterIdleTask(__AdvanceTick);
+    startNs = __GetNs();
+    System_Loop();
+    __Report("dispatch_oneshot", __GetNs() - startNs);
+}
+
+/* create and kill a periodic task while half of the table is in use */
+static void __BenchCreateKill(void)
+{
+    __StartCase();
+    for (u32 i = 0; i < TASK_MAX_NUM / 2; ++i) {
+        System_AddNewLoopTask(__PeriodicTask, 1 + __Rand() % 1024);
+    }
+    startNs = __GetNs();
+    do {
+        System_KillTask(System_AddNewLoopTask(__PeriodicTask, 1 + __Rand() % 1024));
+        ++opNum;
+    } while (!__IsBudgetSpent());
+    __Report("create_kill", __GetNs() - startNs);
+}
+
+/* every 8th task is high priority, all tasks share a period the loop can only serve at 3/4 of the rate (one run
+   takes one tick), so the run order decides which tasks fall behind; without TASK_PRIORITY_NUM both classes mix */
+typedef struct LateClass {
+    u32 late[BENCH_LATE_NUM];
+    u32 num;
+} LateClass;
+
+static LateClass highLate, lowLate;
+static u32 overloadPeriod;
+
+static inline void __RecordLate(LateClass *lateClass, u32 count)
+{
+    u32 late = benchTick - overloadPeriod * (count + 1); // all tasks are released at tick 0 + n periods
+    benchTick++;
+    lateClass->late[lateClass->num++] = late;
+    ++opNum;
+    if (lateClass->num == BENCH_LATE_NUM || __IsBudgetSpent()) {
+        System_EndLoop();
+    }
+}
+
+static void __HighTask(u32 count, u16 state)
+{
+    (void)state;
+    __RecordLate(&highLate, count);
+}
+
+static void __LowTask(u32 count, u16 state)
+{
+    (void)state;
+    __RecordLate(&lowLate, count);
+}
+
+static int __CompareLate(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+    return (x > y) - (x < y);
+}
+
+static void __ReportLate(const char *name, LateClass *lateClass, int64_t elapsedNs)
+{
+    uint64_t sum = 0;
+    for (u32 i = 0; i < lateClass->num; ++i) {
+        sum += lateClass->late[i];
+    }
+    qsort(lateClass->late, lateClass->num, sizeof(lateClass->late[0]), __CompareLate);
+    printf("%s,%u,%u,%s,%u,%.1f,%.1f,%u,%u\n", BENCH_VARIANT, (unsigned)TASK_MAX_NUM, (unsigned)EVENT_MAX_NUM, name, lateClass->num,
+           opNum ? (double)elapsedNs / (double)opNum : 0.0, lateClass->num ? (double)sum / lateClass->num : 0.0,
+           lateClass->num ? lateClass->late[lateClass->num * 99 / 100] : 0, lateClass->num ? lateClass->late[lateClass->num - 1] : 0);
+    fflush(stdout);
+}
+
+static void __BenchOverload(void)
+{
+    __StartCase();
+    highLate.num   = 0;
+    lowLate.num    = 0;
+    overloadPeriod = TASK_MAX_NUM * 3 / 4 ? TASK_MAX_NUM * 3 / 4 : 1;
+    for (u32 i = 0; i < TASK_MAX_NUM; ++i) {
+        Task *task = System_AddNewLoopTask(i % 8 ? __LowTask : __HighTask, overloadPeriod);
+#ifdef TASK_PRIORITY_NUM
+        System_SetTaskPriority(task, (u8)(i % 8 ? TASK_PRIORITY_NUM - 1 : 0));
+#else
+        (void)task;
+#endif
+    }
+    System_RegisterIdleTask(__AdvanceTick);
+    startNs = __GetNs();
+    System_Loop();
+    int64_t elapsedNs = __GetNs() - startNs;
+    __ReportLate("overload_high", &highLate, elapsedNs);
+    __ReportLate("overload_low", &lowLate, elapsedNs);
+}
+
+#ifdef ENABLE_EVENT_TASK
+static Event *benchEvent[EVENT_MAX_NUM];
+
+static void __EventTask(u32 value, u16 signal)
+{
+    (void)value;
+    (void)signal;
+    opNum++;
+}
+
+/* task n subscribes event n % EVENT_MAX_NUM, every event is posted and drained in rounds */
+static void __BenchEventPost(void)
+{
+    __StartCase();
+    for (u32 i = 0; i < EVENT_MAX_NUM; ++i) {
+        benchEvent[i] = System_CreateEvent();
+    }
+    for (u32 i = 0; i < TASK_MAX_NUM; ++i) {
+        System_AddNewEventTask(__EventTask, benchEvent[i % EVENT_MAX_NUM], 1);
+    }
+    System_RegisterIdleTask(__EndWhenIdle);
+    int64_t postNs = 0, dispatchNs = 0;
+    uint64_t postNum = 0;
+    startNs = __GetNs();
+    do {
+        int64_t beginNs = __GetNs();
+        for (u32 i = 0; i < EVENT_MAX_NUM; ++i) {
+            System_SetEvent(benchEvent[i], 1, i);
+        }
+        int64_t postedNs = __GetNs();
+        System_Loop();
+        postNs += postedNs - beginNs;
+        dispatchNs += __GetNs() - postedNs;
+        postNum += EVENT_MAX_NUM;
+    } while (__GetNs() - startNs < budgetNs);
+    uint64_t dispatchNum = opNum;
+    opNum                = postNum;
+    __Report("event_post", postNs);
+    opNum = dispatchNum;
+    __Report("event_dispatch", dispatchNs);
+}
+
+/* every task subscribes the same event, one post wakes all of them */
+static void __BenchEventFanout(void)
+{
+    __StartCase();
+    Event *event = System_CreateEvent();
+    for (u32 i = 0; i < TASK_MAX_NUM; ++i) {
+        System_AddNewEventTask(__EventTask, event, 1);
+    }
+    System_RegisterIdleTask(__EndWhenIdle);
+    startNs = __GetNs();
+    do {
+        System_SetEvent(event, 1, 0);
+        System_Loop();
+    } while (__GetNs() - startNs < budgetNs);
+    __Report("event_fanout", __GetNs() - startNs);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    const char *budget = getenv("BENCH_BUDGET_MS");
+    if (budget && atoi(budget) > 0) {
+        budgetNs = atoi(budget) * 1000000LL;
+    }
+    (void)argv;
+    if (argc > 1) { // any argument prints the CSV header first
+        printf("variant,task_max_num,event_max_num,case,ops,ns_per_op,late_avg,late_p99,late_max\n");
+    }
+    __BenchPeriodic();
+    __BenchOneShot();
+    __BenchCreateKill();
+    __BenchOverload();
+#ifdef ENABLE_EVENT_TASK
+    __BenchEventPost();
+    __BenchEventFanout();
+#endif
+    return 0;
+}
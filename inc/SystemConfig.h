@@ -3,12 +3,37 @@
 
 /* Core Configuration */
 #include <stdint.h>      // device header file
-#define TASK_MAX_NUM  16 // value ≥ 1
-#define EVENT_MAX_NUM 8  // value ≥ 0
+#ifndef TASK_MAX_NUM
+#define TASK_MAX_NUM 16 // value ≥ 1
+#endif
+#ifndef EVENT_MAX_NUM
+#define EVENT_MAX_NUM 8 // value ≥ 0
+#endif
 
 /* Optional Features */
-// #define IDLE_HOOK_FUNCITON // Execute during idle time slots [void (currIdleTick, lastIdleTick)]
-// #define AUTO_SLEEP         // Only effective in the full event-driven framework
+// #define IDLE_HOOK_FUNCITON  // Execute during idle time slots [void (currIdleTick, lastIdleTick)]
+// #define TASK_KILL_HOOK      // Execute when a task is killed or closed [void (func, execState)]
+// #define AUTO_SLEEP          // Only effective in the full event-driven framework
+// #define TIMING_WHEEL 4      // Hierarchical timing wheel for time-based tasks, log2(slots per level) [2~5]
+// #define ISR_EVENT_QUEUE 16  // Lock-free queue behind System_SetEventFromISR, capacity is a power of 2 (C11 atomics)
+// #define TICKLESS_IDLE       // Sleep until the next deadline via System_SleepUntil(tick) instead of spinning
+// #define PORT_POLL 64        // Call the non-blocking System_PortPoll() every N passes of a loop that never idles
+// #define TASK_PRIORITY_NUM 8 // Ready queues for expired time-based tasks, 0 is the highest priority [1~32]
+// #define TASK_EDF            // Earliest deadline first within a priority, requires TASK_PRIORITY_NUM
+// #define TASK_OVERRUN        // Per-task overrun policy of periodic tasks (catch up, skip, coalesce) and overrun counter
+// #define SMP_CORE_NUM 4      // Run System_Loop on up to N threads with per-core ready queues (C11 threads)
+// #define TASK_PROFILE 8      // Per-task run count, execution time and log2 lateness histogram with N buckets, plus CPU load
+// #define TRACE_BUFFER 256    // Record scheduling events into a binary ring of N records (power of 2), see tools/TraceToJson.c
+// #define VIRTUAL_TIME        // The kernel owns the tick and jumps over idle time, for simulation and tests on a host
+// #define EVENT_MAILBOX 4     // Queue up to N posts per event instead of merging them, one handler call per message [1~255]
+// #define PAYLOAD_NUM 16      // Fixed-block payload pool for System_PostEvent, requires EVENT_MAILBOX
+// #define PAYLOAD_SIZE 32     // Bytes per payload block
+// #define TASK_SOA            // Keep links, due ticks, deadlines and callbacks in parallel arrays so list scans stay cache-dense
+// #define STATIC_TASK_TABLE "AppTasks.h" // X-macro list of every task and event, kept in a const table instead of created at runtime
+// #define CYCLIC_TABLE 64     // Dispatch a frozen set of periodic tasks from a hyperperiod table of N slots, see System_FreezeTasks
+// #define TASK_STAGGER 1000   // Start new periodic tasks on the least loaded ticks of a window of N ticks (a multiple of the periods)
+// #define EVENT_BUDGET 32     // Run at most N event task calls per scheduler pass, then due time-based tasks [1~65535]
+// #define TASK_GROUP_NUM 8    // Task groups that are suspended, resumed or killed as a whole by one call, see System_SuspendGroup [1~32]
 
 /* Plugins */
 // New features are in development...
@@ -24,21 +24,101 @@
 #error "'EVENT_MAX_NUM' must be a nonnegative integer (>=0)!"
 #elif EVENT_MAX_NUM == 0
 #pragma message(SYS_PRINT_MSG("Disable Function: event task."))
-#if TASK_MAX_NUM <= 0
-#error "'TASK_MAX_NUM' must be a positive integer (>=1)!"
-#endif
 #ifdef AUTO_SLEEP
-#error "The 'AUTO_SLEEP' function requires enabling event task feature, meaning the 'TASK_MAX_NUM' must be a positive integer (>=1)!"
+#error "The 'AUTO_SLEEP' function requires enabling event task feature, meaning the 'EVENT_MAX_NUM' must be a positive integer (>=1)!"
 #endif
 #else
-#if TASK_MAX_NUM <= 1
-#error "Because a system management thread exists, the value of 'TASK_MAX_NUM' must be greater than 1 (>=2)!"
-#endif
 #define ENABLE_EVENT_TASK
 #endif
-#if TASK_MAX_NUM > 65535
+#if TASK_MAX_NUM <= 0
+#error "'TASK_MAX_NUM' must be a positive integer (>=1)!"
+#elif TASK_MAX_NUM > 65535
 #error "'TASK_MAX_NUM' is too large (>65535)!"
 #endif
+#if defined(TIMING_WHEEL) && (TIMING_WHEEL < 2 || TIMING_WHEEL > 5)
+#error "'TIMING_WHEEL' must be in the range of 2 to 5!"
+#endif
+#ifdef ISR_EVENT_QUEUE
+#ifndef ENABLE_EVENT_TASK
+#error "The 'ISR_EVENT_QUEUE' function requires enabling event task feature!"
+#endif
+#if ISR_EVENT_QUEUE < 2 || (ISR_EVENT_QUEUE & (ISR_EVENT_QUEUE - 1)) != 0
+#error "'ISR_EVENT_QUEUE' must be a power of 2 (>=2)!"
+#endif
+#endif
+#if defined(PORT_POLL) && (PORT_POLL < 1 || PORT_POLL > 65535)
+#error "'PORT_POLL' must be in the range of 1 to 65535!"
+#endif
+#if defined(TASK_PRIORITY_NUM) && (TASK_PRIORITY_NUM < 1 || TASK_PRIORITY_NUM > 32)
+#error "'TASK_PRIORITY_NUM' must be in the range of 1 to 32!"
+#endif
+#if defined(TASK_EDF) && !defined(TASK_PRIORITY_NUM)
+#error "The 'TASK_EDF' function requires 'TASK_PRIORITY_NUM' to be defined!"
+#endif
+#ifdef SMP_CORE_NUM
+#if SMP_CORE_NUM < 1 || SMP_CORE_NUM > 32
+#error "'SMP_CORE_NUM' must be in the range of 1 to 32!"
+#endif
+#if defined(AUTO_SLEEP) || defined(TICKLESS_IDLE)
+#error "The 'SMP_CORE_NUM' function can not be used with 'AUTO_SLEEP' or 'TICKLESS_IDLE'!"
+#endif
+#define SMP_ANY_CORE 0xFF // task affinity: run on whichever core picks it up
+#endif
+#if defined(TASK_PROFILE) && (TASK_PROFILE < 1 || TASK_PROFILE > 32)
+#error "'TASK_PROFILE' must be in the range of 1 to 32!"
+#endif
+#ifdef EVENT_MAILBOX
+#ifndef ENABLE_EVENT_TASK
+#error "The 'EVENT_MAILBOX' function requires enabling event task feature!"
+#endif
+#if EVENT_MAILBOX < 1 || EVENT_MAILBOX > 255
+#error "'EVENT_MAILBOX' must be in the range of 1 to 255!"
+#endif
+#endif
+#ifdef PAYLOAD_NUM
+#ifndef EVENT_MAILBOX
+#error "The 'PAYLOAD_NUM' function requires 'EVENT_MAILBOX' to be defined!"
+#endif
+#if PAYLOAD_NUM < 1 || PAYLOAD_NUM > 65534
+#error "'PAYLOAD_NUM' must be in the range of 1 to 65534!"
+#endif
+#if !defined(PAYLOAD_SIZE) || PAYLOAD_SIZE < 1
+#error "'PAYLOAD_SIZE' must be a positive integer (>=1)!"
+#endif
+#endif
+#if defined(VIRTUAL_TIME) && (defined(AUTO_SLEEP) || defined(TICKLESS_IDLE) || defined(SMP_CORE_NUM))
+#error "The 'VIRTUAL_TIME' function can not be used with 'AUTO_SLEEP', 'TICKLESS_IDLE' or 'SMP_CORE_NUM'!"
+#endif
+#ifdef CYCLIC_TABLE
+#if defined(TIMING_WHEEL) || defined(TASK_PRIORITY_NUM) || defined(SMP_CORE_NUM)
+#error "The 'CYCLIC_TABLE' function replaces the sorted task list, it can not be used with 'TIMING_WHEEL', 'TASK_PRIORITY_NUM' or 'SMP_CORE_NUM'!"
+#endif
+#if CYCLIC_TABLE < 1
+#error "'CYCLIC_TABLE' must be a positive integer (>=1)!"
+#endif
+#endif
+#if defined(TASK_STAGGER) && (TASK_STAGGER < 1 || TASK_STAGGER > 65535)
+#error "'TASK_STAGGER' must be in the range of 1 to 65535!"
+#endif
+#ifdef EVENT_BUDGET
+#ifndef ENABLE_EVENT_TASK
+#error "The 'EVENT_BUDGET' function requires enabling event task feature!"
+#endif
+#if EVENT_BUDGET < 1 || EVENT_BUDGET > 65535
+#error "'EVENT_BUDGET' must be in the range of 1 to 65535!"
+#endif
+#endif
+#ifdef TASK_GROUP_NUM
+#ifdef SMP_CORE_NUM
+#error "The 'TASK_GROUP_NUM' function can not be used with 'SMP_CORE_NUM'!"
+#endif
+#if TASK_GROUP_NUM < 1 || TASK_GROUP_NUM > 32
+#error "'TASK_GROUP_NUM' must be in the range of 1 to 32!"
+#endif
+#endif
+#if defined(TRACE_BUFFER) && (TRACE_BUFFER < 2 || (TRACE_BUFFER & (TRACE_BUFFER - 1)) != 0)
+#error "'TRACE_BUFFER' must be a power of 2 (>=2)!"
+#endif
 
 typedef uint8_t u8;
 typedef uint16_t u16;
@@ -48,9 +128,85 @@ typedef int16_t s16;
 typedef int32_t s32;
 typedef void (*TaskMainFunc)(u32, u16); // task main function
 typedef struct Task Task;               // task handle
+#ifdef TASK_KILL_HOOK
+typedef void (*TaskKillHook)(TaskMainFunc func, u16 execState); // called for a task that is killed or closed
+#endif
 #ifdef ENABLE_EVENT_TASK
 typedef struct Event Event; // event handle
 #endif
+#ifdef EVENT_BUDGET
+typedef struct EventBudgetStats {
+    u32 handlerNum; // event task calls
+    u32 hitNum;     // scheduler passes that stopped at the budget with events left
+} EventBudgetStats;
+#endif
+#ifdef TASK_PROFILE
+typedef struct TaskProfile {
+    u32 runCount;
+    u32 execTotal; // ticks, wraps around on long runs
+    u32 execMin;
+    u32 execMax;
+    u32 lateness[TASK_PROFILE]; // [0] on time, [n] 2^(n-1)~2^n-1 ticks late, the last bucket is open-ended
+} TaskProfile;
+#endif
+#ifdef TASK_OVERRUN
+typedef enum OverrunPolicy {
+    OVERRUN_CATCH_UP, // run every missed period back to back (default)
+    OVERRUN_SKIP,     // drop the missed periods and realign to the next period boundary
+    OVERRUN_COALESCE, // run once for all missed periods, count is the number of dropped periods
+} OverrunPolicy;
+#endif
+#ifdef TRACE_BUFFER
+typedef enum TraceType {
+    TRACE_TASK_START,
+    TRACE_TASK_END,
+    TRACE_EVENT_POST,
+    TRACE_EVENT_DISPATCH,
+    TRACE_TASK_SUSPEND,
+    TRACE_TASK_RESUME,
+    TRACE_TASK_KILL,
+    TRACE_IDLE_ENTER,
+    TRACE_IDLE_EXIT,
+} TraceType;
+#define TRACE_NONE_INDEX 0xFFFF // index of idle records
+
+typedef struct TraceRecord {
+    u32 tick;
+    u16 index; // task index for task records, event index for event records
+    u8 type;   // TraceType
+    u8 core;
+} TraceRecord;
+#endif
+#ifdef STATIC_TASK_TABLE
+// the table file lists STATIC_EVENT(name), STATIC_LOOP_TASK(name, func, interval),
+// STATIC_TEMP_TASK(name, func, delay) and STATIC_EVENT_TASK(name, func, event, signal) entries
+#define STATIC_EVENT(name)
+#define STATIC_LOOP_TASK(name, func, interval)       STATIC_TASK_ID_##name,
+#define STATIC_TEMP_TASK(name, func, delay)          STATIC_TASK_ID_##name,
+#define STATIC_EVENT_TASK(name, func, event, signal) STATIC_TASK_ID_##name,
+enum {
+#include STATIC_TASK_TABLE
+    STATIC_TASK_NUM
+};
+#undef STATIC_EVENT
+#undef STATIC_LOOP_TASK
+#undef STATIC_TEMP_TASK
+#undef STATIC_EVENT_TASK
+#define STATIC_EVENT(name) STATIC_EVENT_ID_##name,
+#define STATIC_LOOP_TASK(name, func, interval)
+#define STATIC_TEMP_TASK(name, func, delay)
+#define STATIC_EVENT_TASK(name, func, event, signal)
+enum {
+#include STATIC_TASK_TABLE
+    STATIC_EVENT_NUM
+};
+#undef STATIC_EVENT
+#undef STATIC_LOOP_TASK
+#undef STATIC_TEMP_TASK
+#undef STATIC_EVENT_TASK
+#define STATIC_TASK_HANDLE(name)  System_GetStaticTask(STATIC_TASK_ID_##name)
+#define STATIC_EVENT_HANDLE(name) System_GetStaticEvent(STATIC_EVENT_ID_##name)
+#endif
 
 #ifndef __cplusplus
 #define NULL  ((void *)0)
@@ -63,10 +219,23 @@ typedef struct Event Event; // event handle
 extern "C" {
 #endif
 /* Pending Interface */
-u32 System_GetCurrTick(void);
+u32 System_GetCurrTick(void); // provided by the kernel when VIRTUAL_TIME is defined
 #ifdef AUTO_SLEEP
 void System_Sleep(void);
 #endif
+#ifdef TICKLESS_IDLE
+void System_SleepUntil(u32 tick);
+#ifdef ISR_EVENT_QUEUE
+void System_Wakeup(void);
+#endif
+#endif
+#ifdef PORT_POLL
+void System_PortPoll(void); // must not block, may post the inputs the port collected (ready fds, completions)
+#endif
+#ifdef SMP_CORE_NUM
+void System_Lock(void); // scheduler lock shared by all cores, need not be recursive
+void System_Unlock(void);
+#endif
 
 /* System Function  */
 void System_Init(void);
@@ -75,35 +244,105 @@ void System_EndLoop(void);
 #ifdef IDLE_HOOK_FUNCITON
 void System_RegisterIdleTask(TaskMainFunc func);
 #endif
+#ifdef TASK_KILL_HOOK
+void System_RegisterKillHook(TaskKillHook hook); // the hook runs inside the kernel, it must not call System_ or Task_
+#endif
+#ifdef VIRTUAL_TIME
+bool System_RunUntil(u32 tick);
+bool System_Step(void);
+#endif
 
 /* Task Creation Function */
+#ifdef STATIC_TASK_TABLE
+Task *System_GetStaticTask(u16 id); // every task of the table is started by System_Init
+#else
 Task *System_AddNewLoopTask(TaskMainFunc func, u32 interval);
+Task *System_AddNewLoopTaskAt(TaskMainFunc func, u32 interval, u32 offset); // first run after offset ticks
 Task *System_AddNewTempTask(TaskMainFunc func, u32 interval);
 #ifdef ENABLE_EVENT_TASK
 Task *System_AddNewEventTask(TaskMainFunc func, Event *event, u16 signal);
 #endif
+#endif
 
 /* Global Task Operation Function */
 bool System_SuspendTask(Task *task, u16 nextState);
 bool System_ResumeTask(Task *task, u16 execState, bool instance);
 bool System_KillTask(Task *task);
+#ifdef TASK_PRIORITY_NUM
+bool System_SetTaskPriority(Task *task, u8 priority);
+#endif
+#ifdef TASK_EDF
+bool System_SetTaskDeadline(Task *task, u32 deadline);
+#endif
+#ifdef TASK_OVERRUN
+bool System_SetTaskOverrun(Task *task, u8 policy);
+u32 System_GetTaskOverrun(Task *task);
+#endif
+#ifdef SMP_CORE_NUM
+bool System_SetTaskAffinity(Task *task, u8 core);
+#endif
+#ifdef TASK_PROFILE
+bool System_GetTaskProfile(Task *task, TaskProfile *profile);
+u8 System_GetCpuLoad(void);
+#endif
+#ifdef CYCLIC_TABLE
+bool System_FreezeTasks(void); // until a time-based task is added, killed, suspended, resumed or delayed
+bool System_IsFrozen(void);
+#endif
+#ifdef TASK_GROUP_NUM
+#define TASK_NO_GROUP 0xFF                      // never suspended or killed by the group calls
+bool System_SetTaskGroup(Task *task, u8 group); // tasks start in TASK_NO_GROUP
+bool System_SuspendGroup(u8 group);
+bool System_ResumeGroup(u8 group);
+bool System_KillGroup(u8 group);
+#endif
+#ifdef TRACE_BUFFER
+u32 System_ReadTrace(TraceRecord *buffer, u32 size);
+#endif
 
 #ifdef ENABLE_EVENT_TASK
 /* Event Task Operation Function  */
+#ifdef STATIC_TASK_TABLE
+Event *System_GetStaticEvent(u16 id);
+#else
 Event *System_CreateEvent(void);
 bool System_DeleteEvent(Event *event);
+#endif
 bool System_SetEvent(Event *event, u16 signal, u32 value);
+#ifdef ISR_EVENT_QUEUE
+bool System_SetEventFromISR(Event *event, u16 signal, u32 value); // true once queued, see System_GetIsrDropCount
+u32 System_GetIsrDropCount(void);
+#endif
+#ifdef PAYLOAD_NUM
+void *System_AllocPayload(void);
+bool System_FreePayload(void *payload);
+bool System_PostEvent(Event *event, u16 signal, u32 value, void *payload);
+#endif
+bool System_IsEventValid(Event *event);
+bool System_IsEventHandle(Event *event); // range check only, callable from any thread
 u16 System_GetEventSignal(Event *event);
+#ifdef EVENT_BUDGET
+bool System_GetEventBudgetStats(EventBudgetStats *stats);
+#endif
 #endif
 
 /* Current Task Operation Function */
 bool Task_Yield(u16 nextState);
-bool Task_Delay(u16 ticks, u16 nextState);
+bool Task_Delay(u32 ticks, u16 nextState);
+bool Task_DelayUntil(u32 tick, u16 nextState);
 bool Task_Suspend(u16 nextState);
 #ifdef ENABLE_EVENT_TASK
 bool Task_ListenSingal(u16 newSignal);
+#ifndef STATIC_TASK_TABLE
+bool Task_ListenEvent(Event *event, u16 newSignal);
 #endif
+#endif
+u16 Task_GetState(void);
+bool Task_SetState(u16 nextState); // resume point of a task that keeps waiting without a delay, e.g. an event task
 void Task_Close(void);
+#ifdef PAYLOAD_NUM
+void *Task_GetPayload(void);
+#endif
 #ifdef __cplusplus
 }
 #endif
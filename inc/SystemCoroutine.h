@@ -0,0 +1,95 @@
+/**
+ * @brief   Stackless coroutines (protothreads) on top of the task execState.
+ *
+ *          The resume point of a coroutine is the execState of its task, so it costs no RAM beyond the Task slot.
+ *          Locals do not survive an await, keep them static or in a context struct. Each await must be on its own
+ *          line (the line number is the resume point) and must not be inside another switch.
+ *
+ *          void Sensor_Main(u32 value, u16 state)
+ *          {
+ *              CO_BEGIN();
+ *              Sensor_StartConversion();
+ *              CO_AWAIT_DELAY(20);
+ *              CO_AWAIT_UNTIL(Sensor_IsReady());
+ *              Sensor_Publish(Sensor_Read());
+ *              CO_END();
+ *          }
+ *
+ *   ┌─────────────────────────────┬─────────────┬─────────────┬─────────────┐
+ *   │            AWAIT            │ circle task │ single task │ events task │
+ *   ├─────────────────────────────┼─────────────┼─────────────┼─────────────┤
+ *   │ CO_AWAIT_YIELD()            │      √      │      √      │      √      │
+ *   │ CO_AWAIT_DELAY(ticks)       │      √      │      √      │      √      │
+ *   │ CO_AWAIT_UNTIL(condition)   │      √      │      √      │      √      │
+ *   │ CO_AWAIT_SIGNAL(signal)     │      ×      │      ×      │      √      │
+ *   │ CO_AWAIT_EVENT(event, sig)  │      ×      │      ×      │      √      │
+ *   └─────────────────────────────┴─────────────┴─────────────┴─────────────┘
+ *   Note: A finished periodic task starts over at CO_BEGIN in its next period, a finished event task at its next
+ *         event, which is the last (event, signal) it waited for. An event task resumed after CO_AWAIT_SIGNAL or
+ *         CO_AWAIT_EVENT gets the (value, signal) of that event, and (0, 0) after CO_AWAIT_DELAY, CO_AWAIT_YIELD or
+ *         CO_AWAIT_UNTIL.
+ **/
+#ifndef __SYSTEM_COROUTINE_H
+#define __SYSTEM_COROUTINE_H
+
+#include "SystemCore.h"
+
+#define CO_BEGIN()                                                                                                     \
+    switch (Task_GetState()) {                                                                                         \
+    case 0:
+#define CO_END()                                                                                                       \
+    }                                                                                                                  \
+    Task_SetState(0)
+#define CO_EXIT()                                                                                                      \
+    do {                                                                                                               \
+        Task_SetState(0);                                                                                              \
+        return;                                                                                                        \
+    } while (0)
+
+// event tasks cannot yield, they are delayed by 0 ticks instead
+#define __CO_YIELD(point)                                                                                              \
+    if (!Task_Yield(point)) {                                                                                          \
+        Task_Delay(0, point);                                                                                          \
+    }
+
+#define CO_AWAIT_YIELD()                                                                                               \
+    do {                                                                                                               \
+        __CO_YIELD(__LINE__)                                                                                           \
+        return;                                                                                                        \
+    case __LINE__:;                                                                                                    \
+    } while (0)
+#define CO_AWAIT_DELAY(ticks)                                                                                          \
+    do {                                                                                                               \
+        Task_Delay((ticks), __LINE__);                                                                                 \
+        return;                                                                                                        \
+    case __LINE__:;                                                                                                    \
+    } while (0)
+// polls the condition once per scheduler pass
+#define CO_AWAIT_UNTIL(condition)                                                                                      \
+    do {                                                                                                               \
+        while (!(condition)) {                                                                                         \
+            __CO_YIELD(__LINE__)                                                                                       \
+            return;                                                                                                    \
+        case __LINE__:;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+#ifdef ENABLE_EVENT_TASK
+#define CO_AWAIT_SIGNAL(signal)                                                                                        \
+    do {                                                                                                               \
+        Task_ListenSingal(signal);                                                                                     \
+        Task_SetState(__LINE__);                                                                                       \
+        return;                                                                                                        \
+    case __LINE__:;                                                                                                    \
+    } while (0)
+#ifndef STATIC_TASK_TABLE
+#define CO_AWAIT_EVENT(event, signal)                                                                                  \
+    do {                                                                                                               \
+        Task_ListenEvent((event), (signal));                                                                           \
+        Task_SetState(__LINE__);                                                                                       \
+        return;                                                                                                        \
+    case __LINE__:;                                                                                                    \
+    } while (0)
+#endif
+#endif
+#endif
\ No newline at end of file
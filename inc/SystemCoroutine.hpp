@@ -0,0 +1,271 @@
+/**
+ * @brief   C++20 coroutine wrappers for MinSys tasks.
+ *
+ *          MinSys::Coroutine Blink()
+ *          {
+ *              for (;;) {
+ *                  Led_Toggle();
+ *                  co_await MinSys::Delay{500};
+ *              }
+ *          }
+ *          static MinSys::Frames<128, 2> blinkFrames; // up to 2 tasks, 128 bytes of frame each
+ *          System_AddNewTempTask(MinSys::Run<Blink, blinkFrames>, 0);
+ *
+ *          Run<Body, Pool> is a plain TaskMainFunc that starts Body on the first call of a task and resumes it on
+ *          the later ones. Every task that runs it gets its own frame in a slot of Pool, and the execState of the
+ *          task holds the slot, so it must not be changed by other means. There is no heap: a task is closed when
+ *          Pool has no free slot or the frame is larger than the slot (the size of a frame depends on the compiler).
+ *          The slot is freed when the frame returns; a periodic or event task then starts a new frame on its next
+ *          call. A task killed or closed while its frame is suspended frees the slot through ReleaseFrame, which
+ *          must be the TASK_KILL_HOOK (System_RegisterKillHook(MinSys::ReleaseFrame)) or be called from it; the frame
+ *          is destroyed there, inside the kernel. An exception that leaves Body calls std::terminate. Awaiting Delay,
+ *          Yield, WaitSignal or WaitEvent maps to Task_Delay, Task_Yield, Task_ListenSingal or Task_ListenEvent, the
+ *          same resume points as the macros in SystemCoroutine.h.
+ **/
+#ifndef __SYSTEM_COROUTINE_HPP
+#define __SYSTEM_COROUTINE_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+#include "SystemCore.h"
+
+#ifndef TASK_KILL_HOOK
+#error "The C++ coroutines need 'TASK_KILL_HOOK' to free the frame of a killed task!"
+#endif
+
+namespace MinSys {
+
+namespace Detail {
+#ifdef SMP_CORE_NUM
+inline thread_local void *nextFrame; // slot reserved by Run for the frame Body is about to allocate
+inline thread_local std::size_t nextFrameSize;
+#else
+inline void *nextFrame;
+inline std::size_t nextFrameSize;
+#endif
+
+// the slots of a pool may be taken by tasks on several cores
+inline void LockFrames()
+{
+#ifdef SMP_CORE_NUM
+    System_Lock();
+#endif
+}
+
+inline void UnlockFrames()
+{
+#ifdef SMP_CORE_NUM
+    System_Unlock();
+#endif
+}
+
+// one per Run instance that has taken a slot, so ReleaseFrame can find the pool of a task function
+struct FrameOwner {
+    TaskMainFunc run;
+    void (*release)(u16 slot);
+    FrameOwner *next;
+    bool linked;
+};
+inline FrameOwner *frameOwners;
+
+// called with the frames locked
+inline void LinkFrameOwner(FrameOwner &owner)
+{
+    if (!owner.linked) {
+        owner.next   = frameOwners;
+        frameOwners  = &owner;
+        owner.linked = true;
+    }
+}
+} // namespace Detail
+
+struct TaskArgs {
+    u32 value; // count, or the event value
+    u16 state; // execState, or the event signal
+};
+
+class Coroutine {
+  public:
+    struct promise_type {
+        TaskArgs args{};
+        u16 state = 0; // execState of the task while the frame is suspended, its slot in the pool + 1
+
+        // the frame goes to the slot reserved by Run, null makes Body() return an empty Coroutine
+        static void *operator new(std::size_t size) noexcept
+        {
+            void *frame       = size <= Detail::nextFrameSize ? Detail::nextFrame : nullptr;
+            Detail::nextFrame = nullptr;
+            return frame;
+        }
+        static void operator delete(void *) noexcept {}
+        static Coroutine get_return_object_on_allocation_failure() noexcept { return Coroutine(nullptr); }
+        Coroutine get_return_object() noexcept
+        {
+            return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); } // the task could not be resumed or closed
+    };
+
+    explicit Coroutine(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+    std::coroutine_handle<promise_type> Release() noexcept { return std::exchange(handle, nullptr); }
+    ~Coroutine()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+    Coroutine(const Coroutine &)            = delete;
+    Coroutine &operator=(const Coroutine &) = delete;
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// arguments of the call that resumed the coroutine, never suspends
+struct Args {
+    std::coroutine_handle<Coroutine::promise_type> handle{};
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<Coroutine::promise_type> self) noexcept
+    {
+        handle = self;
+        return false;
+    }
+    TaskArgs await_resume() const noexcept { return handle.promise().args; }
+};
+
+struct Yield {
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<Coroutine::promise_type> self) const noexcept
+    {
+        return Task_Yield(self.promise().state) || Task_Delay(0, self.promise().state);
+    }
+    void await_resume() const noexcept {}
+};
+
+struct Delay {
+    u32 ticks;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<Coroutine::promise_type> self) const noexcept
+    {
+        return Task_Delay(ticks, self.promise().state);
+    }
+    void await_resume() const noexcept {}
+};
+
+#ifdef ENABLE_EVENT_TASK
+// waits in an event task for a signal of its event, resumes with the event value
+struct WaitSignal {
+    u16 signal;
+    std::coroutine_handle<Coroutine::promise_type> handle{};
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<Coroutine::promise_type> self) noexcept
+    {
+        handle = self;
+        return Task_ListenSingal(signal) && Task_SetState(self.promise().state);
+    }
+    u32 await_resume() const noexcept { return handle.promise().args.value; }
+};
+
+#ifndef STATIC_TASK_TABLE
+// moves an event task to another (event, signal) and waits for it, resumes with the event value
+struct WaitEvent {
+    Event *event;
+    u16 signal;
+    std::coroutine_handle<Coroutine::promise_type> handle{};
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<Coroutine::promise_type> self) noexcept
+    {
+        handle = self;
+        return Task_ListenEvent(event, signal) && Task_SetState(self.promise().state);
+    }
+    u32 await_resume() const noexcept { return handle.promise().args.value; }
+};
+#endif
+#endif
+
+// caller-provided storage for the frames of up to Num tasks that run the same body, Size bytes each
+template <std::size_t Size, u16 Num = 1>
+struct Frames {
+    static_assert(Num > 0 && Num < 0xFFFF, "the execState of a task holds its slot + 1");
+    alignas(std::max_align_t) unsigned char frame[Num][Size];
+    std::coroutine_handle<Coroutine::promise_type> handle[Num];
+};
+
+template <Coroutine (*Body)(), auto &Pool>
+void Run(u32 value, u16 state);
+
+namespace Detail {
+template <Coroutine (*Body)(), auto &Pool>
+struct Owner {
+    // the kernel calls it through ReleaseFrame with the scheduler lock held, so the frames are already locked
+    static void Release(u16 slot)
+    {
+        constexpr u16 num = std::extent_v<decltype(Pool.handle)>;
+        if (slot == 0 || slot > num || !Pool.handle[slot - 1]) {
+            return;
+        }
+        Pool.handle[slot - 1].destroy();
+        Pool.handle[slot - 1] = nullptr;
+    }
+    inline static FrameOwner node{&Run<Body, Pool>, &Release, nullptr, false};
+};
+} // namespace Detail
+
+template <Coroutine (*Body)(), auto &Pool>
+void Run(u32 value, u16 state)
+{
+    constexpr u16 num = std::extent_v<decltype(Pool.handle)>;
+    u16 slot          = Task_GetState();
+    if (slot == 0 || slot > num || !Pool.handle[slot - 1]) {
+        Detail::LockFrames();
+        for (slot = 1; slot <= num && Pool.handle[slot - 1]; ++slot) {}
+        if (slot <= num) {
+            Detail::LinkFrameOwner(Detail::Owner<Body, Pool>::node);
+            Detail::nextFrame     = Pool.frame[slot - 1];
+            Detail::nextFrameSize = sizeof(Pool.frame[0]);
+            Pool.handle[slot - 1] = Body().Release();
+        }
+        Detail::UnlockFrames();
+        if (slot > num || !Pool.handle[slot - 1]) {
+            Task_SetState(0); // holds no slot, the kill hook must not free one
+            Task_Close();     // no free slot, or the frame does not fit
+            return;
+        }
+        Pool.handle[slot - 1].promise().state = slot;
+    }
+    std::coroutine_handle<Coroutine::promise_type> handle = Pool.handle[slot - 1];
+    handle.promise().args                                 = TaskArgs{value, state};
+    handle.resume();
+    if (handle.done()) {
+        handle.destroy();
+        Detail::LockFrames();
+        Pool.handle[slot - 1] = nullptr;
+        Detail::UnlockFrames();
+        Task_SetState(0); // an event task keeps its execState, it starts a new frame on its next event
+    }
+}
+
+// TaskKillHook: frees the slot of a task that ran Run and was killed or closed while its frame was suspended
+inline void ReleaseFrame(TaskMainFunc func, u16 execState)
+{
+    for (Detail::FrameOwner *owner = Detail::frameOwners; owner; owner = owner->next) {
+        if (owner->run == func) {
+            owner->release(execState);
+            return;
+        }
+    }
+}
+
+} // namespace MinSys
+#endif
\ No newline at end of file
@@ -0,0 +1,367 @@
+#define _GNU_SOURCE
+#include "SystemPort.h"
+#if defined(SMP_CORE_NUM) || defined(PORT_OFFLOAD)
+#include <pthread.h>
+#endif
+#ifdef SMP_CORE_NUM
+#include <sched.h>
+#endif
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct timespec startTime;
+static int timerFd = -1, wakeFd = -1, epollFd = -1;
+#ifdef PORT_FD_TASK
+#define __FD_NUM PORT_FD_MAX
+#else
+#define __FD_NUM 0
+#endif
+#define __WAKE_ID  (__FD_NUM + 0) // epoll data of wakeFd
+#define __TIMER_ID (__FD_NUM + 1) // epoll data of timerFd
+#define __READY_NUM 8
+
+#ifdef PORT_FD_TASK
+typedef struct FdSlot {
+    int fd;       // -1 when free
+    Event *event; // kept after removal until the task has closed and the event can be deleted
+    Task *task;
+} FdSlot;
+
+static FdSlot fdSlot[PORT_FD_MAX];
+#endif
+#ifdef PORT_OFFLOAD
+typedef struct OffloadJob {
+    OffloadFunc func;
+    void *arg;
+    Event *event;
+    u16 signal;
+    u32 result;
+} OffloadJob;
+
+// a job index moves from the free stack to the pending ring, then to the done ring and back, all under offloadMutex
+static OffloadJob offloadJob[PORT_OFFLOAD_MAX];
+static u16 jobFree[PORT_OFFLOAD_MAX], jobPending[PORT_OFFLOAD_MAX], jobDone[PORT_OFFLOAD_MAX];
+static u16 jobFreeNum, pendingHead, pendingSize, doneHead, doneSize;
+static pthread_mutex_t offloadMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t offloadCond    = PTHREAD_COND_INITIALIZER;
+#endif
+#ifdef SMP_CORE_NUM
+static pthread_mutex_t schedMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static inline int64_t __GetElapsedNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - startTime.tv_sec) * 1000000000LL + (now.tv_nsec - startTime.tv_nsec);
+}
+
+#ifdef PORT_OFFLOAD
+static inline u16 __PopJob(u16 *ring, u16 *head, u16 *size)
+{
+    u16 index = ring[*head];
+    *head     = (u16)((*head + 1) % PORT_OFFLOAD_MAX);
+    --*size;
+    return index;
+}
+
+static inline void __PushJob(u16 *ring, u16 head, u16 *size, u16 index)
+{
+    ring[(head + *size) % PORT_OFFLOAD_MAX] = index;
+    ++*size;
+}
+
+// runs in the loop thread: a job whose event was deleted is dropped, one whose post fails because the event is still
+// full (same signal pending, or a full mailbox) goes to the back of the ring and is retried on the next poll
+// returns true if a completion was posted
+static bool __PostOffloadDone(void)
+{
+    bool posted = false;
+    pthread_mutex_lock(&offloadMutex);
+    for (u16 num = doneSize; num; --num) {
+        u16 index       = __PopJob(jobDone, &doneHead, &doneSize);
+        OffloadJob *job = offloadJob + index;
+        if (job->event && System_IsEventValid(job->event)) {
+            if (System_SetEvent(job->event, job->signal, job->result) == false) {
+                __PushJob(jobDone, doneHead, &doneSize, index);
+                continue;
+            }
+            posted = true;
+        }
+        jobFree[jobFreeNum++] = index;
+    }
+    pthread_mutex_unlock(&offloadMutex);
+    return posted;
+}
+
+static void *__OffloadWorker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&offloadMutex);
+    for (;;) {
+        while (pendingSize == 0) {
+            pthread_cond_wait(&offloadCond, &offloadMutex);
+        }
+        u16 index = __PopJob(jobPending, &pendingHead, &pendingSize);
+        pthread_mutex_unlock(&offloadMutex);
+        offloadJob[index].result = offloadJob[index].func(offloadJob[index].arg);
+        pthread_mutex_lock(&offloadMutex);
+        __PushJob(jobDone, doneHead, &doneSize, index);
+        System_Wakeup();
+    }
+    return NULL;
+}
+
+// the pool outlives System_Init, it is only started once
+static inline bool __StartOffloadWorkers(void)
+{
+    static bool started = false;
+    if (started) {
+        return true;
+    }
+    for (u16 i = PORT_OFFLOAD_MAX; i > 0; --i) {
+        jobFree[jobFreeNum++] = (u16)(i - 1);
+    }
+    for (u32 i = 0; i < PORT_WORKER_NUM; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, __OffloadWorker, NULL) != 0) {
+            return false;
+        }
+        pthread_detach(thread);
+    }
+    started = true;
+    return true;
+}
+#endif
+
+// timeout: -1 blocks, 0 only collects the fds that are ready
+static void __WaitWakeup(int timeout)
+{
+    struct epoll_event ready[__READY_NUM];
+    uint64_t count;
+#ifdef PORT_OFFLOAD
+    if (__PostOffloadDone()) {
+        timeout = 0; // a completion was posted, the loop must dispatch it before it sleeps
+    }
+#endif
+    int num = epoll_wait(epollFd, ready, __READY_NUM, timeout);
+    for (int i = 0; i < num; ++i) {
+        u32 id = ready[i].data.u32;
+#ifdef PORT_FD_TASK
+        if (id < PORT_FD_MAX) {
+            if (fdSlot[id].fd >= 0) {
+                System_SetEvent(fdSlot[id].event, PORT_FD_SIGNAL, ready[i].events);
+            }
+            continue;
+        }
+#endif
+        if (id == __WAKE_ID) {
+            (void)!read(wakeFd, &count, sizeof(count));
+#ifdef PORT_OFFLOAD
+            __PostOffloadDone();
+#endif
+        } else if (id == __TIMER_ID) {
+            (void)!read(timerFd, &count, sizeof(count));
+        }
+    }
+}
+
+static inline bool __AddEpollFd(int fd, u32 events, u32 id)
+{
+    struct epoll_event ev = {.events = events, .data.u32 = id};
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool System_PortInit(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wakeFd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+#ifdef PORT_FD_TASK
+    for (u32 i = 0; i < PORT_FD_MAX; ++i) {
+        fdSlot[i].fd    = -1;
+        fdSlot[i].event = NULL;
+        fdSlot[i].task  = NULL;
+    }
+#endif
+    if (timerFd < 0 || wakeFd < 0 || epollFd < 0 || !__AddEpollFd(wakeFd, EPOLLIN, __WAKE_ID) || !__AddEpollFd(timerFd, EPOLLIN, __TIMER_ID)) {
+        return false;
+    }
+#ifdef PORT_OFFLOAD
+    return __StartOffloadWorkers();
+#else
+    return true;
+#endif
+}
+
+u32 System_GetCurrTick(void)
+{
+    return (u32)(__GetElapsedNs() / PORT_TICK_NS);
+}
+
+void System_Sleep(void)
+{
+    struct itimerspec its = {0};
+    timerfd_settime(timerFd, 0, &its, NULL); // disarm, only wakeups and fds end the sleep
+    __WaitWakeup(-1);
+}
+
+void System_SleepUntil(u32 tick)
+{
+    // widen the wrapping tick to an absolute deadline of the monotonic clock
+    int64_t currTick = __GetElapsedNs() / PORT_TICK_NS;
+    int64_t deadline = (currTick + (s32)(tick - (u32)currTick)) * PORT_TICK_NS;
+    if (deadline <= currTick * PORT_TICK_NS) {
+        __WaitWakeup(0); // still collect the ready fds
+        return;
+    }
+    struct itimerspec its = {0};
+    its.it_value.tv_sec   = startTime.tv_sec + (time_t)(deadline / 1000000000LL);
+    its.it_value.tv_nsec  = startTime.tv_nsec + (long)(deadline % 1000000000LL);
+    if (its.it_value.tv_nsec >= 1000000000L) {
+        its.it_value.tv_sec++;
+        its.it_value.tv_nsec -= 1000000000L;
+    }
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+        __WaitWakeup(-1);
+    }
+}
+
+#ifdef PORT_POLL
+void System_PortPoll(void)
+{
+    __WaitWakeup(0);
+}
+#endif
+
+void System_Wakeup(void)
+{
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+}
+
+#ifdef PORT_FD_TASK
+// a removed slot is reusable once its task has closed and released the event
+static inline bool __IsFdSlotFree(FdSlot *slot)
+{
+    if (slot->fd >= 0) {
+        return false;
+    }
+    if (slot->event && System_DeleteEvent(slot->event)) {
+        slot->event = NULL;
+    }
+    return slot->event == NULL;
+}
+
+Task *System_AddNewFdTask(int fd, u32 events, TaskMainFunc func)
+{
+    if (fd < 0 || func == NULL) {
+        return NULL;
+    }
+    for (u32 i = 0; i < PORT_FD_MAX; ++i) {
+        FdSlot *slot = fdSlot + i;
+        if (!__IsFdSlotFree(slot)) {
+            continue;
+        }
+        if ((slot->event = System_CreateEvent()) == NULL) {
+            return NULL;
+        }
+        if ((slot->task = System_AddNewEventTask(func, slot->event, PORT_FD_SIGNAL)) == NULL) {
+            System_DeleteEvent(slot->event);
+            slot->event = NULL;
+            return NULL;
+        }
+        if (!__AddEpollFd(fd, events, i)) {
+            System_KillTask(slot->task);
+            System_DeleteEvent(slot->event);
+            slot->event = NULL;
+            return NULL;
+        }
+        slot->fd = fd;
+        return slot->task;
+    }
+    return NULL;
+}
+
+bool System_RemoveFdTask(Task *task)
+{
+    for (u32 i = 0; i < PORT_FD_MAX; ++i) {
+        FdSlot *slot = fdSlot + i;
+        if (slot->fd >= 0 && slot->task == task) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, slot->fd, NULL);
+            slot->fd   = -1;
+            slot->task = NULL;
+            System_KillTask(task); // a running task closes after it returns, the event is deleted on reuse
+            __IsFdSlotFree(slot);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#ifdef PORT_OFFLOAD
+bool System_Offload(OffloadFunc func, void *arg, Event *event, u16 signal)
+{
+    if (func == NULL || (event && (signal == 0 || System_IsEventHandle(event) == false))) {
+        return false; // the completion could never be posted, a deleted event is only seen when it is posted
+    }
+    pthread_mutex_lock(&offloadMutex);
+    if (jobFreeNum == 0) {
+        pthread_mutex_unlock(&offloadMutex);
+        return false;
+    }
+    u16 index       = jobFree[--jobFreeNum];
+    OffloadJob *job = offloadJob + index;
+    job->func       = func;
+    job->arg        = arg;
+    job->event      = event;
+    job->signal     = signal;
+    __PushJob(jobPending, pendingHead, &pendingSize, index);
+    pthread_cond_signal(&offloadCond);
+    pthread_mutex_unlock(&offloadMutex);
+    return true;
+}
+#endif
+
+#ifdef SMP_CORE_NUM
+void System_Lock(void)
+{
+    pthread_mutex_lock(&schedMutex);
+}
+
+void System_Unlock(void)
+{
+    pthread_mutex_unlock(&schedMutex);
+}
+
+static void *__CoreThread(void *arg)
+{
+    long cpuNum = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpuNum > 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((int)((long)arg % cpuNum), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    System_Loop();
+    return NULL;
+}
+
+bool System_PortLoop(void)
+{
+    pthread_t threads[SMP_CORE_NUM];
+    long created = 0;
+    while (created < SMP_CORE_NUM && pthread_create(threads + created, NULL, __CoreThread, (void *)created) == 0) {
+        ++created;
+    }
+    for (long i = 0; i < created; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    return created == SMP_CORE_NUM;
+}
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @brief   Linux reference port of MinSys.
+ *
+ *          Provides the pending interfaces on top of CLOCK_MONOTONIC:
+ *            - System_GetCurrTick : ticks of PORT_TICK_NS since System_PortInit
+ *            - System_Sleep       : blocks in epoll_wait until System_Wakeup or a ready fd
+ *            - System_SleepUntil  : same, plus a timerfd armed for the tick, only polls for a tick already reached
+ *            - System_PortPoll    : collects the ready fds and completions without blocking (PORT_POLL)
+ *            - System_Wakeup      : signals an eventfd, safe in signal handlers and other threads
+ *            - System_Lock/Unlock : a pthread mutex shared by the scheduler cores (SMP_CORE_NUM)
+ *
+ *          With TICKLESS_IDLE and ENABLE_EVENT_TASK, System_AddNewFdTask() adds an event task that runs with
+ *          (epoll events, PORT_FD_SIGNAL) when its fd is ready. Readiness is collected in System_SleepUntil when the loop
+ *          idles and in System_PortPoll every PORT_POLL passes when it never idles, and is dispatched by System_Loop like
+ *          any other event. The fd is level-triggered unless EPOLLET is given, so the task should drain it. Other
+ *          threads post through System_SetEventFromISR (ISR_EVENT_QUEUE), which wakes the loop through the eventfd.
+ *
+ *          With the same options, System_Offload() runs a slow job on one of PORT_WORKER_NUM threads. Its return value
+ *          is posted to the given event by the loop thread after the job, so task functions stay short.
+ **/
+#ifndef __SYSTEM_PORT_H
+#define __SYSTEM_PORT_H
+
+#include "SystemCore.h"
+
+#ifndef PORT_TICK_NS
+#define PORT_TICK_NS 1000000L // 1 tick = 1 ms
+#endif
+
+#if defined(TICKLESS_IDLE) && defined(ENABLE_EVENT_TASK) && !defined(PORT_POLL)
+#error "The fd tasks and the offload pool of the port need 'PORT_POLL', or a busy loop never sees their inputs!"
+#endif
+
+#if defined(TICKLESS_IDLE) && defined(ENABLE_EVENT_TASK) && !defined(STATIC_TASK_TABLE)
+#define PORT_FD_TASK
+#ifndef PORT_FD_MAX
+#define PORT_FD_MAX 16 // max number of fd tasks
+#endif
+#define PORT_FD_SIGNAL 1 // signal of the readiness events, the value is the epoll event mask
+#endif
+
+#if defined(TICKLESS_IDLE) && defined(ENABLE_EVENT_TASK)
+#define PORT_OFFLOAD
+#ifndef PORT_WORKER_NUM
+#define PORT_WORKER_NUM 2 // threads of the offload pool
+#endif
+#ifndef PORT_OFFLOAD_MAX
+#define PORT_OFFLOAD_MAX 32 // max number of jobs that are queued, running or waiting for their completion post
+#endif
+typedef u32 (*OffloadFunc)(void *arg);
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+bool System_PortInit(void); // call before System_Init
+void System_Sleep(void);
+void System_SleepUntil(u32 tick);
+void System_Wakeup(void);
+#ifdef PORT_POLL
+void System_PortPoll(void);
+#endif
+#ifdef PORT_FD_TASK
+Task *System_AddNewFdTask(int fd, u32 events, TaskMainFunc func); // events: EPOLLIN, EPOLLOUT, EPOLLET ...
+bool System_RemoveFdTask(Task *task);                             // use instead of System_KillTask/Task_Close
+#endif
+#ifdef PORT_OFFLOAD
+bool System_Offload(OffloadFunc func, void *arg, Event *event, u16 signal); // any thread, event may be NULL
+#endif
+#ifdef SMP_CORE_NUM
+void System_Lock(void);
+void System_Unlock(void);
+bool System_PortLoop(void); // runs System_Loop on SMP_CORE_NUM threads, thread n pinned to CPU n
+#endif
+#ifdef __cplusplus
+}
+#endif
+#endif
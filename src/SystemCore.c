@@ -1,4 +1,19 @@
 #include "SystemCore.h"
+#if defined(ISR_EVENT_QUEUE) || defined(SMP_CORE_NUM)
+#include <stdatomic.h>
+#endif
+
+#ifdef SMP_CORE_NUM
+#define __CORE_LOCAL _Thread_local // execution context of the calling scheduler core
+#ifndef TASK_PRIORITY_NUM
+#define TASK_PRIORITY_NUM 1 // per-core ready queues
+#endif
+#define READY_QUEUE_NUM SMP_CORE_NUM
+#define SMP_CORE_MASK   ((u32)(SMP_CORE_NUM == 32 ? 0xFFFFFFFFU : (1U << SMP_CORE_NUM) - 1U))
+#else
+#define __CORE_LOCAL
+#define READY_QUEUE_NUM 1
+#endif
 
 #if TASK_MAX_NUM > 255
 typedef u16 TaskIndex;
@@ -16,14 +31,84 @@ typedef u8 EvtIndex;
 #define __EndOfEvtList ((EvtIndex) - 1)
 
 typedef struct Event {
-    u32 value;
+    u32 value; // next free event while disabled
     u16 signal;
-    bool enable;
-    TaskIndex subList;
+    bool enable : 1;
+    bool queued : 1; // waiting in the event queue
+    TaskIndex subNum;
+#ifdef EVENT_MAILBOX
+    u8 msgHead, msgSize; // pending messages in the mailbox ring of the event
+#endif
 } Event;
 
 static Event eventList[EVENT_MAX_NUM];
-static EvtIndex eventQueue[EVENT_MAX_NUM];
+static EvtIndex eventQueue[EVENT_MAX_NUM]; // FIFO ring buffer, each event queued at most once
+static EvtIndex evtQueueHead, evtQueueSize;
+#ifndef STATIC_TASK_TABLE
+static EvtIndex freeEvtIndex;
+#endif
+
+#ifdef PAYLOAD_NUM
+#if PAYLOAD_NUM > 255
+typedef u16 PayloadIndex;
+#else
+typedef u8 PayloadIndex;
+#endif
+
+#define __EndOfPayload ((PayloadIndex) - 1)
+
+typedef union PayloadBlock {
+    u8 data[PAYLOAD_SIZE];
+    PayloadIndex next; // next free block while released
+    uint64_t align;
+    void *ptr;
+} PayloadBlock;
+
+static PayloadBlock payloadPool[PAYLOAD_NUM];
+static PayloadIndex freePayloadIndex;
+static __CORE_LOCAL void *currPayload; // payload of the message being dispatched
+#endif
+
+#if defined(EVENT_MAILBOX) || defined(EVENT_BUDGET)
+typedef struct EventMessage {
+    u32 value;
+    u16 signal;
+#ifdef PAYLOAD_NUM
+    PayloadIndex payload;
+#endif
+} EventMessage;
+#endif
+
+#ifdef EVENT_MAILBOX
+static EventMessage eventMailbox[EVENT_MAX_NUM][EVENT_MAILBOX];
+#endif
+
+#ifdef EVENT_BUDGET
+// the delivery cut short by the budget, resumed at evtNextTaskIndex in the next pass
+static Event *pausedEvent; // NULL if none
+static EventMessage pausedMessage;
+#ifdef EVENT_MAILBOX
+static u8 pausedBatch; // messages of the batch after pausedMessage
+#endif
+static u16 handlerBudget; // event task calls left in this pass
+static EventBudgetStats budgetStats;
+#endif
+
+#ifdef ISR_EVENT_QUEUE
+#define ISR_QUEUE_MASK (ISR_EVENT_QUEUE - 1U)
+
+typedef struct IsrEventCell {
+    _Atomic u32 seq; // equals the ticket when free, ticket + 1 when published
+    EvtIndex event;
+    u16 signal;
+    u32 value;
+} IsrEventCell;
+
+static IsrEventCell isrQueue[ISR_EVENT_QUEUE]; // bounded MPSC queue, drained by System_Loop
+static _Atomic u32 isrQueueTail;
+static u32 isrQueueHead;
+static u32 isrDropNum; // queued posts System_SetEvent refused when the queue was drained
+#endif
 #endif
 
 typedef enum TaskType {
@@ -34,44 +119,335 @@ typedef enum TaskType {
 
 typedef union TaskInfo {
     struct {
+#ifndef STATIC_TASK_TABLE
         u32 interval;
-        u32 nextRunTime;
+#endif
         u32 count;
     } timebased;
 #ifdef ENABLE_EVENT_TASK
     struct {
         bool suspend;
+        bool delay; // waiting in the time-based task list
+        TaskIndex prev;
         u16 signal;
-        Event *event;
-        u32 nextRunTime;
+#ifndef STATIC_TASK_TABLE
+        EvtIndex event;
+#endif
     } eventbased;
 #endif
 } TaskInfo;
 
+// TASK_SOA moves the fields walked by the list scans (next, nextRunTime, deadline) and the callback into parallel arrays
 struct Task {
     u16 execState;
     TaskIndex curr;
+#ifndef TASK_SOA
     TaskIndex next;
+#endif
+#ifdef TIMING_WHEEL
+    TaskIndex prev;
+    u8 slot;
+#endif
+#ifdef STATIC_TASK_TABLE
+    bool closed; // killed or finished, the slot is never reused
+#else
     TaskType type;
+#endif
+#ifdef TASK_PRIORITY_NUM
+    u8 priority;
+    bool ready; // waiting in a ready queue
+#endif
+#ifdef TASK_OVERRUN
+    u8 overrunPolicy; // OverrunPolicy of a periodic task
+    u32 overrunNum;   // runs that ended after the next release was already due
+#endif
+#ifdef TASK_STAGGER
+    u16 staggerSlot; // window slot of the first release counted in staggerLoad
+#endif
+#ifdef TASK_GROUP_NUM
+    u8 group;                       // TASK_NO_GROUP, or the group whose member list holds the task
+    bool parked;                    // came due while its group was suspended, waiting in groupParked
+    TaskIndex groupPrev, groupNext; // links of the member list
+#endif
+#ifdef SMP_CORE_NUM
+    u8 affinity;  // SMP_ANY_CORE or the only core allowed to run the task
+    u8 core;      // ready queue holding the task
+    bool running; // executing on some core, the scheduler lock is not held meanwhile
+#endif
+#ifndef TASK_SOA
+    u32 nextRunTime;
+#ifdef TASK_EDF
+    u32 deadline; // relative to nextRunTime
+#endif
+#ifndef STATIC_TASK_TABLE
     TaskMainFunc func;
+#endif
+#endif
     TaskInfo info;
 };
 
+#ifdef STATIC_TASK_TABLE
+// immutable part of a task, kept in read-only memory
+typedef struct StaticTask {
+    TaskMainFunc func;
+    u32 interval; // period of a periodic task, first delay of a one-shot task
+    u8 type;      // TaskType
+#ifdef ENABLE_EVENT_TASK
+    EvtIndex event;
+    u16 signal; // initial signal, Task_ListenSingal changes the copy in RAM
+#endif
+} StaticTask;
+
+#define STATIC_LOOP_TASK(name, func, interval)      void func(u32, u16);
+#define STATIC_TEMP_TASK(name, func, delay)         void func(u32, u16);
+#define STATIC_EVENT_TASK(name, func, event, signal) void func(u32, u16);
+#define STATIC_EVENT(name)
+#include STATIC_TASK_TABLE
+#undef STATIC_LOOP_TASK
+#undef STATIC_TEMP_TASK
+#undef STATIC_EVENT_TASK
+
+#ifdef ENABLE_EVENT_TASK
+#define STATIC_LOOP_TASK(name, func, interval)      {func, interval, TASKTYPE_CIRCULATE, 0, 0},
+#define STATIC_TEMP_TASK(name, func, delay)         {func, delay, TASKTYPE_DISPOSABLE, 0, 0},
+#define STATIC_EVENT_TASK(name, func, event, signal) {func, 0, TASKTYPE_EVENT, STATIC_EVENT_ID_##event, signal},
+#else
+#define STATIC_LOOP_TASK(name, func, interval) {func, interval, TASKTYPE_CIRCULATE},
+#define STATIC_TEMP_TASK(name, func, delay)    {func, delay, TASKTYPE_DISPOSABLE},
+#endif
+static const StaticTask staticTaskTable[TASK_MAX_NUM] = {
+#include STATIC_TASK_TABLE
+};
+#undef STATIC_LOOP_TASK
+#undef STATIC_TEMP_TASK
+#undef STATIC_EVENT_TASK
+#undef STATIC_EVENT
+
+_Static_assert(STATIC_TASK_NUM == TASK_MAX_NUM, "'TASK_MAX_NUM' must equal the number of tasks in 'STATIC_TASK_TABLE'");
+#ifdef ENABLE_EVENT_TASK
+_Static_assert(STATIC_EVENT_NUM == EVENT_MAX_NUM, "'EVENT_MAX_NUM' must equal the number of events in 'STATIC_TASK_TABLE'");
+#endif
+
+#define __TaskFunc(task)     (staticTaskTable[(task)->curr].func)
+#define __TaskType(task)     ((TaskType)staticTaskTable[(task)->curr].type)
+#define __TaskInterval(task) (staticTaskTable[(task)->curr].interval)
+#define __TaskEvent(task)    (eventList + staticTaskTable[(task)->curr].event)
+#define __IsTaskFree(task)   ((task)->closed)
+#else
+#ifdef TASK_SOA
+#define __TaskFunc(task) (taskFunc[(task) - taskList])
+#else
+#define __TaskFunc(task) ((task)->func)
+#endif
+#define __TaskType(task)     ((task)->type)
+#define __TaskInterval(task) ((task)->info.timebased.interval)
+#define __TaskEvent(task)    (eventList + (task)->info.eventbased.event)
+#define __IsTaskFree(task)   (__TaskFunc(task) == NULL)
+#endif
+
+#ifdef TASK_SOA
+#define __TaskNext(task)     (taskNext[(task) - taskList])
+#define __TaskRunTime(task)  (taskRunTime[(task) - taskList])
+#define __TaskDeadline(task) (taskDeadline[(task) - taskList])
+#else
+#define __TaskNext(task)     ((task)->next)
+#define __TaskRunTime(task)  ((task)->nextRunTime)
+#define __TaskDeadline(task) ((task)->deadline)
+#endif
+
+#ifdef SMP_CORE_NUM
+static _Atomic bool looping;
+static u32 loopCoreMask; // cores currently inside System_Loop
+static __CORE_LOCAL u8 currCoreId;
+#else
 static bool looping;
-static u16 taskFlag; // [0~7]:delay [8]:delay [9]:close [10]:suspend
+#endif
+static __CORE_LOCAL u16 taskFlag;  // [8]:delay [9]:close [10]:suspend [12]:delay until
+static __CORE_LOCAL u32 taskDelay; // ticks of a pending delay, or its due tick with FLAG_UNTIL_MASK
 #ifdef IDLE_HOOK_FUNCITON
 static TaskMainFunc idleTask;
 #endif
+#ifdef TASK_KILL_HOOK
+static TaskKillHook killHook;
+#endif
+#ifdef VIRTUAL_TIME
+static u32 virtualTick; // kernel-owned clock, moved forward over idle time only
+#endif
 
-static TaskIndex currTimeTaskIndex, currExecTaskIndex;
+static __CORE_LOCAL TaskIndex currExecTaskIndex = (TaskIndex)-1; // also valid on threads outside System_Loop
+#ifndef STATIC_TASK_TABLE
+static TaskIndex freeTaskIndex;
+#endif
 static Task taskList[TASK_MAX_NUM];
+#ifdef TASK_SOA
+static TaskIndex taskNext[TASK_MAX_NUM];
+static u32 taskRunTime[TASK_MAX_NUM];
+#ifdef TASK_EDF
+static u32 taskDeadline[TASK_MAX_NUM];
+#endif
+#ifndef STATIC_TASK_TABLE
+static TaskMainFunc taskFunc[TASK_MAX_NUM];
+#endif
+#endif
+
+#ifdef ENABLE_EVENT_TASK
+#if TASK_MAX_NUM <= 16
+#define SUB_BUCKET_NUM 16
+#elif TASK_MAX_NUM <= 64
+#define SUB_BUCKET_NUM 64
+#elif TASK_MAX_NUM <= 256
+#define SUB_BUCKET_NUM 256
+#else
+#define SUB_BUCKET_NUM 1024
+#endif
+
+// active event tasks hashed by (event, signal), in subscription order
+static TaskIndex subBucketHead[SUB_BUCKET_NUM], subBucketTail[SUB_BUCKET_NUM];
+static TaskIndex evtNextTaskIndex; // dispatch cursor, kept valid across unlinks
+#endif
 
 #define __EndOfTaskList   ((TaskIndex) - 1)
-#define DELAY_TIME_MASK   ((u16)((1U << 8) - 1))
 #define FLAG_DELAY_MASK   ((u16)(1U << 8))
 #define FLAG_CLOSE_MASK   ((u16)(1U << 9))
 #define FLAG_SUSPEND_MASK ((u16)(1U << 10))
 #define FLAG_YIELD_MASK   ((u16)(1U << 11))
+#define FLAG_UNTIL_MASK   ((u16)(1U << 12))
+
+#ifdef TIMING_WHEEL
+#define WHEEL_SLOT_NUM  (1U << TIMING_WHEEL)
+#define WHEEL_SLOT_MASK (WHEEL_SLOT_NUM - 1)
+#define WHEEL_LEVEL_NUM ((32 + TIMING_WHEEL - 1) / TIMING_WHEEL)
+#define WHEEL_DUE_SLOT  (WHEEL_LEVEL_NUM * WHEEL_SLOT_NUM) // expired tasks in FIFO order
+#define WHEEL_NONE_SLOT ((u8) - 1)
+
+static u32 wheelTime; // next tick to be processed by the wheel
+static u32 wheelBitmap[WHEEL_LEVEL_NUM];
+static TaskIndex wheelTaskNum; // tasks waiting in the wheel levels
+static TaskIndex wheelSlot[WHEEL_DUE_SLOT + 1];
+#else
+static TaskIndex currTimeTaskIndex;
+#endif
+
+#ifdef CYCLIC_TABLE
+typedef struct CyclicSlot {
+    u32 offset; // release tick relative to the start of the hyperperiod
+    TaskIndex task;
+} CyclicSlot;
+
+// while cyclicNum != 0 the time-based list is empty and its tasks are released from the table instead
+static CyclicSlot cyclicTable[CYCLIC_TABLE];
+static u32 cyclicNum, cyclicCursor;
+static u32 cyclicStart, cyclicPeriod; // tick of the current hyperperiod, its length
+#endif
+
+#ifdef TASK_STAGGER
+#define __NoStaggerSlot ((u16) - 1)
+
+static u16 staggerLoad[TASK_STAGGER]; // periodic releases on each tick of the window (tick % TASK_STAGGER)
+#endif
+
+#ifdef TASK_GROUP_NUM
+static u32 groupEnable;                       // bit n is set while group n may run
+static TaskIndex groupHead[TASK_GROUP_NUM];   // members of each group, so group calls never scan the task table
+static TaskIndex groupParked[TASK_GROUP_NUM]; // due tasks of a suspended group, in no other list
+
+#define __IsTaskGroupEnabled(task) ((task)->group == TASK_NO_GROUP || ((groupEnable >> (task)->group) & 1U) != 0)
+#else
+#define __IsTaskGroupEnabled(task) true
+#endif
+
+#ifdef TASK_PROFILE
+static TaskProfile taskProfile[TASK_MAX_NUM];
+static u32 busyTicks, loadStartTick; // execution time since the last System_GetCpuLoad
+#endif
+
+#ifdef TRACE_BUFFER
+#define TRACE_BUFFER_MASK (TRACE_BUFFER - 1U)
+
+// written under the scheduler lock only, ISR posts are recorded once drained
+static TraceRecord traceRing[TRACE_BUFFER];
+static u32 traceHead, traceTail; // records written / read so far, the ring keeps the latest TRACE_BUFFER
+static __CORE_LOCAL bool traceIdle;
+
+static inline void __TraceRecord(TraceType type, u16 index)
+{
+    TraceRecord *record = traceRing + (traceHead++ & TRACE_BUFFER_MASK);
+    record->tick        = System_GetCurrTick();
+    record->index       = index;
+    record->type        = type;
+#ifdef SMP_CORE_NUM
+    record->core = currCoreId;
+#else
+    record->core = 0;
+#endif
+}
+
+static inline void __TraceIdle(bool idle)
+{
+    if (traceIdle != idle) {
+        traceIdle = idle;
+        __TraceRecord(idle ? TRACE_IDLE_ENTER : TRACE_IDLE_EXIT, TRACE_NONE_INDEX);
+    }
+}
+
+#define __TRACE(type, index) __TraceRecord(type, (u16)(index))
+#define __TRACE_IDLE(idle)   __TraceIdle(idle)
+#else
+#define __TRACE(type, index) ((void)0)
+#define __TRACE_IDLE(idle)   ((void)0)
+#endif
+
+#ifdef TASK_PRIORITY_NUM
+static TaskIndex readyHead[READY_QUEUE_NUM][TASK_PRIORITY_NUM], readyTail[READY_QUEUE_NUM][TASK_PRIORITY_NUM];
+static u32 readyBitmap[READY_QUEUE_NUM]; // bit n is set while priority n has ready tasks
+#endif
+
+static inline void __LockScheduler(void)
+{
+#ifdef SMP_CORE_NUM
+    System_Lock();
+#endif
+}
+
+static inline void __UnlockScheduler(void)
+{
+#ifdef SMP_CORE_NUM
+    System_Unlock();
+#endif
+}
+
+static inline u8 __CountTrailingZeros(u32 x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (u8)__builtin_ctz(x);
+#else
+    u8 n = 0;
+    while ((x & 1U) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+#ifdef SMP_CORE_NUM
+#define __IDLE_SPIN_MAX 1024 // relax hints an idle core waits at most before it takes the scheduler lock again
+
+// an idle core waits twice as long after every idle pass, so it leaves the lock to the cores that run tasks
+static inline void __IdleBackoff(u32 *spin)
+{
+    for (u32 i = 0; i < *spin; ++i) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+        __asm__ volatile("yield");
+#else
+        atomic_signal_fence(memory_order_seq_cst);
+#endif
+    }
+    *spin = *spin ? (*spin < __IDLE_SPIN_MAX ? *spin * 2 : __IDLE_SPIN_MAX) : 1;
+}
+#endif
 
 static inline bool __IsTaskParamInvalid(Task *task)
 {
@@ -79,445 +455,2409 @@ static inline bool __IsTaskParamInvalid(Task *task)
         return true;
     }
     static Task *end = taskList + TASK_MAX_NUM - 1;
-    return task < taskList || task > end || taskList[task->curr].func == NULL;
+    return task < taskList || task > end || __IsTaskFree(taskList + task->curr);
+}
+
+// a task running on another core is owned by that core until its function returns
+static inline bool __IsTaskBusyOnOtherCore(Task *task)
+{
+#ifdef SMP_CORE_NUM
+    return task->running && currExecTaskIndex != task->curr;
+#else
+    (void)task;
+    return false;
+#endif
 }
 
 static inline void __ClearTaskNode(Task *task)
 {
-    task->next      = __EndOfTaskList;
-    task->func      = NULL;
-    task->info      = (TaskInfo){0};
-    task->execState = 0;
+    __TaskNext(task) = __EndOfTaskList;
+#ifdef TIMING_WHEEL
+    task->slot = WHEEL_NONE_SLOT;
+#endif
+#ifdef STATIC_TASK_TABLE
+    task->closed = true;
+#else
+    __TaskFunc(task) = NULL;
+#endif
+    task->info          = (TaskInfo){0};
+    __TaskRunTime(task) = 0;
+    task->execState     = 0;
+#ifdef TASK_PRIORITY_NUM
+    task->priority = 0;
+    task->ready    = false;
+#endif
+#ifdef TASK_OVERRUN
+    task->overrunPolicy = OVERRUN_CATCH_UP;
+    task->overrunNum    = 0;
+#endif
+#ifdef TASK_STAGGER
+    task->staggerSlot = __NoStaggerSlot;
+#endif
+#ifdef TASK_GROUP_NUM
+    task->group     = TASK_NO_GROUP;
+    task->parked    = false;
+    task->groupPrev = __EndOfTaskList;
+    task->groupNext = __EndOfTaskList;
+#endif
+#ifdef TASK_EDF
+    __TaskDeadline(task) = 0;
+#endif
+#ifdef SMP_CORE_NUM
+    task->affinity = SMP_ANY_CORE;
+    task->core     = 0;
+    task->running  = false;
+#endif
+}
+
+#ifdef TASK_STAGGER
+// delay of the first release in [1, interval] whose releases meet the least loaded ticks, the latest of equal ones
+static inline u32 __GetStaggeredOffset(u32 currTick, u32 interval)
+{
+    u32 best = interval, bestMax = 0xFFFFFFFFU, bestSum = 0xFFFFFFFFU;
+    u32 num  = interval < TASK_STAGGER ? interval : TASK_STAGGER;
+    for (u32 i = 0; i < num; ++i) {
+        u32 slot = (currTick + interval - i) % TASK_STAGGER, max = 0, sum = 0;
+        for (u32 offset = 0;; offset += interval) {
+            u16 load = staggerLoad[(slot + offset) % TASK_STAGGER];
+            max      = load > max ? load : max;
+            sum += load;
+            if (interval >= TASK_STAGGER - offset) {
+                break;
+            }
+        }
+        if (max < bestMax || (max == bestMax && sum < bestSum)) {
+            best    = interval - i;
+            bestMax = max;
+            bestSum = sum;
+        }
+    }
+    return best;
+}
+
+// counts (or uncounts) every release of a periodic task within one window
+static inline void __CountStaggerLoad(u16 slot, u32 interval, bool add)
+{
+    for (u32 offset = 0;; offset += interval) {
+        u16 *load = staggerLoad + (slot + offset) % TASK_STAGGER;
+        *load     = add ? *load + 1 : *load - 1;
+        if (interval >= TASK_STAGGER - offset) {
+            break;
+        }
+    }
+}
+
+static inline void __LoadTaskStagger(Task *task)
+{
+    if (__TaskInterval(task) != 0) { // an interval of 0 is due on every pass and has no phase
+        task->staggerSlot = (u16)(__TaskRunTime(task) % TASK_STAGGER);
+        __CountStaggerLoad(task->staggerSlot, __TaskInterval(task), true);
+    }
+}
+
+static inline void __UnloadTaskStagger(Task *task)
+{
+    if (task->staggerSlot != __NoStaggerSlot) {
+        __CountStaggerLoad(task->staggerSlot, __TaskInterval(task), false);
+        task->staggerSlot = __NoStaggerSlot;
+    }
+}
+
+// recounts the releases of a task whose due tick was rebased off its period grid
+static inline void __MoveTaskStagger(Task *task)
+{
+    __UnloadTaskStagger(task);
+    __LoadTaskStagger(task);
+}
+#endif
+
+#ifdef TASK_GROUP_NUM
+static inline void __JoinTaskGroup(Task *task, u8 group)
+{
+    task->group = group;
+    if (group == TASK_NO_GROUP) {
+        return;
+    }
+    task->groupPrev = __EndOfTaskList;
+    task->groupNext = groupHead[group];
+    if (groupHead[group] != __EndOfTaskList) {
+        taskList[groupHead[group]].groupPrev = task->curr;
+    }
+    groupHead[group] = task->curr;
+}
+
+static inline void __LeaveTaskGroup(Task *task)
+{
+    if (task->group == TASK_NO_GROUP) {
+        return;
+    }
+    if (task->groupPrev == __EndOfTaskList) {
+        groupHead[task->group] = task->groupNext;
+    } else {
+        taskList[task->groupPrev].groupNext = task->groupNext;
+    }
+    if (task->groupNext != __EndOfTaskList) {
+        taskList[task->groupNext].groupPrev = task->groupPrev;
+    }
+    task->group = TASK_NO_GROUP;
+}
+#endif
+
+#ifdef STATIC_TASK_TABLE
+static inline void __InitTaskNode(Task *task)
+{
+    __ClearTaskNode(task);
+#ifdef TASK_PROFILE
+    taskProfile[task->curr]         = (TaskProfile){0};
+    taskProfile[task->curr].execMin = 0xFFFFFFFFU;
+#endif
+    task->closed = false;
 }
 
+static inline void __FreeTaskNode(Task *task)
+{
+#ifdef TASK_KILL_HOOK
+    if (killHook) {
+        killHook(__TaskFunc(task), task->execState); // before the slot forgets what the task held
+    }
+#endif
+#ifdef TASK_STAGGER
+    __UnloadTaskStagger(task);
+#endif
+#ifdef TASK_GROUP_NUM
+    __LeaveTaskGroup(task);
+#endif
+    __ClearTaskNode(task);
+}
+#else
 static inline void __InitTaskNode(Task *task, TaskType type, TaskMainFunc func)
 {
     __ClearTaskNode(task);
-    task->type = type;
-    task->func = func;
+#ifdef TASK_PROFILE
+    taskProfile[task->curr]         = (TaskProfile){0};
+    taskProfile[task->curr].execMin = 0xFFFFFFFFU;
+#endif
+    task->type       = type;
+    __TaskFunc(task) = func;
 }
 
-static inline void __LinkTimebasedTaskNode(Task *task)
+static inline Task *__AllocTaskNode(TaskType type, TaskMainFunc func)
 {
-    TaskIndex prev = __EndOfTaskList, curr = currTimeTaskIndex;
-    while (curr != __EndOfTaskList && task->info.timebased.nextRunTime >= taskList[curr].info.timebased.nextRunTime) {
+    if (freeTaskIndex == __EndOfTaskList) {
+        return NULL;
+    }
+    Task *task    = taskList + freeTaskIndex;
+    freeTaskIndex = __TaskNext(task);
+    __InitTaskNode(task, type, func);
+    return task;
+}
+
+static inline void __FreeTaskNode(Task *task)
+{
+#ifdef TASK_KILL_HOOK
+    if (killHook) {
+        killHook(__TaskFunc(task), task->execState); // before the slot forgets what the task held
+    }
+#endif
+#ifdef TASK_STAGGER
+    __UnloadTaskStagger(task);
+#endif
+#ifdef TASK_GROUP_NUM
+    __LeaveTaskGroup(task);
+#endif
+    __ClearTaskNode(task);
+    __TaskNext(task) = freeTaskIndex;
+    freeTaskIndex    = task->curr;
+}
+#endif
+
+static inline bool __SetNextNodeOfPrevTaskNode(Task *task, TaskIndex startNode)
+{
+    TaskIndex prev = __EndOfTaskList, curr = startNode;
+    while (curr != task->curr) {
+        prev = curr;
+        curr = __TaskNext(taskList + curr);
+        if (curr == __EndOfTaskList) {
+            return true;
+        }
+    }
+    __TaskNext(taskList + prev) = __TaskNext(task);
+    return false;
+}
+
+#ifdef TASK_GROUP_NUM
+static inline void __ParkTaskNode(Task *task)
+{
+#ifdef TASK_STAGGER
+    __UnloadTaskStagger(task); // counted again when the group resumes
+#endif
+    __TaskNext(task)         = groupParked[task->group];
+    groupParked[task->group] = task->curr;
+    task->parked             = true;
+}
+
+static inline void __UnparkTaskNode(Task *task)
+{
+    if (groupParked[task->group] == task->curr) {
+        groupParked[task->group] = __TaskNext(task);
+    } else {
+        __SetNextNodeOfPrevTaskNode(task, groupParked[task->group]);
+    }
+    __TaskNext(task) = __EndOfTaskList;
+    task->parked     = false;
+}
+#endif
+
+#ifdef TASK_PRIORITY_NUM
+#ifdef SMP_CORE_NUM
+#define __ReadyQueueOf(task) ((task)->core)
+#else
+#define __ReadyQueueOf(task) 0
+#endif
+
+static inline void __PushReadyTaskNode(Task *task)
+{
+    u8 queue       = __ReadyQueueOf(task);
+    u8 priority    = task->priority;
+    TaskIndex prev = readyTail[queue][priority], curr = __EndOfTaskList;
+#ifdef TASK_EDF
+    // ordered by absolute deadline, FIFO among equal deadlines
+    u32 deadline = __TaskRunTime(task) + __TaskDeadline(task);
+    prev         = __EndOfTaskList;
+    curr         = readyHead[queue][priority];
+    while (curr != __EndOfTaskList && (s32)(__TaskRunTime(taskList + curr) + __TaskDeadline(taskList + curr) - deadline) <= 0) {
         prev = curr;
-        curr = taskList[curr].next;
+        curr = __TaskNext(taskList + curr);
     }
+#endif
+    __TaskNext(task) = curr;
+    task->ready      = true;
     if (prev == __EndOfTaskList) {
-        task->next        = currTimeTaskIndex;
-        currTimeTaskIndex = task->curr;
+        readyHead[queue][priority] = task->curr;
+    } else {
+        __TaskNext(taskList + prev) = task->curr;
+    }
+    if (curr == __EndOfTaskList) {
+        readyTail[queue][priority] = task->curr;
+    }
+    readyBitmap[queue] |= 1U << priority;
+}
+
+static inline void __UnlinkReadyTaskNode(Task *task)
+{
+    u8 queue       = __ReadyQueueOf(task);
+    u8 priority    = task->priority;
+    TaskIndex prev = __EndOfTaskList, curr = readyHead[queue][priority];
+    while (curr != task->curr) {
+        prev = curr;
+        curr = __TaskNext(taskList + curr);
+    }
+    if (prev == __EndOfTaskList) {
+        readyHead[queue][priority] = __TaskNext(task);
     } else {
-        taskList[prev].next = task->curr;
-        task->next          = curr;
+        __TaskNext(taskList + prev) = __TaskNext(task);
+    }
+    if (readyTail[queue][priority] == task->curr) {
+        readyTail[queue][priority] = prev;
+    }
+    if (readyHead[queue][priority] == __EndOfTaskList) {
+        readyBitmap[queue] &= ~(1U << priority);
+    }
+    __TaskNext(task) = __EndOfTaskList;
+    task->ready      = false;
+}
+#endif
+
+#ifdef TIMING_WHEEL
+static inline void __PushWheelSlot(Task *task, u8 slot)
+{
+    TaskIndex head = wheelSlot[slot];
+    task->slot     = slot;
+    if (head == __EndOfTaskList) {
+        task->prev       = task->curr;
+        __TaskNext(task) = task->curr;
+        wheelSlot[slot]  = task->curr;
+        if (slot != WHEEL_DUE_SLOT) {
+            wheelBitmap[slot / WHEEL_SLOT_NUM] |= 1U << (slot % WHEEL_SLOT_NUM);
+        }
+    } else {
+        task->prev                                 = taskList[head].prev;
+        __TaskNext(task)                           = head;
+        __TaskNext(taskList + taskList[head].prev) = task->curr;
+        taskList[head].prev                        = task->curr;
+    }
+    if (slot != WHEEL_DUE_SLOT) {
+        ++wheelTaskNum;
+    }
+}
+
+static inline void __PopWheelSlot(Task *task)
+{
+    u8 slot = task->slot;
+    if (__TaskNext(task) == task->curr) {
+        wheelSlot[slot] = __EndOfTaskList;
+        if (slot != WHEEL_DUE_SLOT) {
+            wheelBitmap[slot / WHEEL_SLOT_NUM] &= ~(1U << (slot % WHEEL_SLOT_NUM));
+        }
+    } else {
+        __TaskNext(taskList + task->prev) = __TaskNext(task);
+        taskList[__TaskNext(task)].prev   = task->prev;
+        if (wheelSlot[slot] == task->curr) {
+            wheelSlot[slot] = __TaskNext(task);
+        }
+    }
+    if (slot != WHEEL_DUE_SLOT) {
+        --wheelTaskNum;
+    }
+    __TaskNext(task) = __EndOfTaskList;
+    task->slot       = WHEEL_NONE_SLOT;
+}
+
+static inline void __LinkTimebasedTaskNode(Task *task)
+{
+    u32 delta = __TaskRunTime(task) - wheelTime;
+    u8 level  = 0;
+    if ((s32)delta < 0) {
+        __PushWheelSlot(task, WHEEL_DUE_SLOT);
+        return;
+    }
+    while (level < WHEEL_LEVEL_NUM - 1 && (delta >> (TIMING_WHEEL * (level + 1))) != 0) {
+        ++level;
+    }
+    __PushWheelSlot(task, level * WHEEL_SLOT_NUM + ((__TaskRunTime(task) >> (TIMING_WHEEL * level)) & WHEEL_SLOT_MASK));
+}
+
+static inline bool __UnlinkTimebasedTaskNode(Task *task)
+{
+#ifdef TASK_GROUP_NUM
+    if (task->parked) {
+        __UnparkTaskNode(task);
+        return true;
+    }
+#endif
+#ifdef TASK_PRIORITY_NUM
+    if (task->ready) {
+        __UnlinkReadyTaskNode(task);
+        return true;
+    }
+#endif
+    if (task->slot == WHEEL_NONE_SLOT) {
+        return false;
+    }
+    __PopWheelSlot(task);
+    return true;
+}
+
+static inline void __MoveWheelSlot(u8 slot, bool expire)
+{
+    while (wheelSlot[slot] != __EndOfTaskList) {
+        Task *task = taskList + wheelSlot[slot];
+        __PopWheelSlot(task);
+        if (expire) {
+            __PushWheelSlot(task, WHEEL_DUE_SLOT);
+        } else {
+            __LinkTimebasedTaskNode(task);
+        }
+    }
+}
+
+static void __AdvanceTimingWheel(u32 currTick)
+{
+    while ((s32)(currTick - wheelTime) >= 0) {
+        if (wheelTaskNum == 0) {
+            wheelTime = currTick + 1;
+            return;
+        }
+        u32 index = wheelTime & WHEEL_SLOT_MASK;
+        if (index == 0) {
+            u32 time = wheelTime;
+            for (u8 level = 1; level < WHEEL_LEVEL_NUM && (time & WHEEL_SLOT_MASK) == 0; ++level) {
+                time >>= TIMING_WHEEL;
+                __MoveWheelSlot(level * WHEEL_SLOT_NUM + (time & WHEEL_SLOT_MASK), false);
+            }
+        }
+        __MoveWheelSlot(index, true);
+        // skip empty slots up to the next occupied one or the next cascade boundary
+        u32 pending = (wheelBitmap[0] >> index) >> 1;
+        u32 step    = pending ? __CountTrailingZeros(pending) + 1U : WHEEL_SLOT_NUM - index;
+        wheelTime += step > currTick - wheelTime ? currTick - wheelTime + 1 : step;
+    }
+}
+
+static inline TaskIndex __PopTimebasedTaskNode(u32 currTick)
+{
+    TaskIndex index = wheelSlot[WHEEL_DUE_SLOT];
+    if (index == __EndOfTaskList) {
+        __AdvanceTimingWheel(currTick);
+        index = wheelSlot[WHEEL_DUE_SLOT];
+        if (index == __EndOfTaskList) {
+            return __EndOfTaskList;
+        }
+    }
+    __PopWheelSlot(taskList + index);
+    return index;
+}
+
+static inline bool __IsTimebasedListEmpty(void)
+{
+    return wheelTaskNum == 0 && wheelSlot[WHEEL_DUE_SLOT] == __EndOfTaskList;
+}
+
+#if defined(TICKLESS_IDLE) || defined(VIRTUAL_TIME)
+// earliest tick at which the wheel has work: a level 0 expiry or a cascade of a higher level
+static u32 __GetNextTimebasedTick(void)
+{
+    u32 nextDelta = 0x7FFFFFFFU;
+    if (wheelSlot[WHEEL_DUE_SLOT] != __EndOfTaskList) {
+        return wheelTime;
+    }
+    for (u8 level = 0; level < WHEEL_LEVEL_NUM; ++level) {
+        u32 bitmap = wheelBitmap[level];
+        if (bitmap == 0) {
+            continue;
+        }
+        u8 shift   = TIMING_WHEEL * level;
+        u32 lower  = (1U << shift) - 1;
+        u32 start  = (wheelTime + lower) & ~lower;
+        u32 digit  = (start >> shift) & WHEEL_SLOT_MASK;
+        u32 higher = bitmap >> digit;
+        u32 slots  = higher ? __CountTrailingZeros(higher) : WHEEL_SLOT_NUM - digit + __CountTrailingZeros(bitmap);
+        u32 delta  = slots > (0x7FFFFFFFU >> shift) ? 0x7FFFFFFFU : start - wheelTime + (slots << shift);
+        if (delta < nextDelta) {
+            nextDelta = delta;
+        }
+    }
+    return wheelTime + nextDelta;
+}
+#endif
+#else
+#ifdef CYCLIC_TABLE
+static void __ThawCyclicTable(void);
+#endif
+
+static inline void __LinkTimebasedTaskNode(Task *task)
+{
+#ifdef CYCLIC_TABLE
+    if (cyclicNum) {
+        if (task->curr == currExecTaskIndex && taskFlag == 0) {
+            return; // finished a period, its next release is already in the table
+        }
+        __ThawCyclicTable();
+    }
+#endif
+    TaskIndex prev = __EndOfTaskList, curr = currTimeTaskIndex;
+    while (curr != __EndOfTaskList && __TaskRunTime(task) >= __TaskRunTime(taskList + curr)) {
+        prev = curr;
+        curr = __TaskNext(taskList + curr);
+    }
+    if (prev == __EndOfTaskList) {
+        __TaskNext(task)  = currTimeTaskIndex;
+        currTimeTaskIndex = task->curr;
+    } else {
+        __TaskNext(taskList + prev) = task->curr;
+        __TaskNext(task)            = curr;
+    }
+}
+
+static inline bool __UnlinkTimebasedTaskNode(Task *task)
+{
+#ifdef TASK_GROUP_NUM
+    if (task->parked) {
+        __UnparkTaskNode(task);
+        return true;
+    }
+#endif
+#ifdef TASK_PRIORITY_NUM
+    if (task->ready) {
+        __UnlinkReadyTaskNode(task);
+        return true;
+    }
+#endif
+#ifdef CYCLIC_TABLE
+    __ThawCyclicTable();
+#endif
+    if (currTimeTaskIndex == task->curr) {
+        currTimeTaskIndex = __TaskNext(task);
+    } else if (currTimeTaskIndex == __EndOfTaskList || __SetNextNodeOfPrevTaskNode(task, currTimeTaskIndex)) {
+        return false;
+    }
+    __TaskNext(task) = __EndOfTaskList;
+    return true;
+}
+
+#ifdef CYCLIC_TABLE
+// O(1) per slot: steps through the releases that are due, a slot before the first release of its task is skipped
+static inline TaskIndex __PopCyclicTaskNode(u32 currTick)
+{
+    while ((s32)(currTick - cyclicStart - cyclicTable[cyclicCursor].offset) >= 0) {
+        CyclicSlot *slot = cyclicTable + cyclicCursor;
+        u32 due          = cyclicStart + slot->offset;
+        if (++cyclicCursor == cyclicNum) {
+            cyclicCursor = 0;
+            cyclicStart += cyclicPeriod;
+        }
+        s32 ahead = (s32)(__TaskRunTime(taskList + slot->task) - due);
+        if (ahead == 0) {
+            return slot->task;
+        } else if (ahead < 0) {
+            __ThawCyclicTable(); // the task fell off its slots, let the sorted list catch it up
+            break;
+        }
+    }
+    return __EndOfTaskList;
+}
+#endif
+
+static inline TaskIndex __PopTimebasedTaskNode(u32 currTick)
+{
+#ifdef CYCLIC_TABLE
+    if (cyclicNum) {
+        TaskIndex index = __PopCyclicTaskNode(currTick);
+        if (cyclicNum) {
+            return index;
+        }
+    }
+#endif
+    TaskIndex index = currTimeTaskIndex;
+    if (index == __EndOfTaskList || currTick < __TaskRunTime(taskList + index)) {
+        return __EndOfTaskList;
+    }
+    currTimeTaskIndex            = __TaskNext(taskList + index);
+    __TaskNext(taskList + index) = __EndOfTaskList;
+    return index;
+}
+
+static inline bool __IsTimebasedListEmpty(void)
+{
+#ifdef CYCLIC_TABLE
+    if (cyclicNum) {
+        return false;
+    }
+#endif
+    return currTimeTaskIndex == __EndOfTaskList;
+}
+
+#if defined(TICKLESS_IDLE) || defined(VIRTUAL_TIME)
+static inline u32 __GetNextTimebasedTick(void)
+{
+#ifdef CYCLIC_TABLE
+    if (cyclicNum) {
+        return cyclicStart + cyclicTable[cyclicCursor].offset;
+    }
+#endif
+    return __TaskRunTime(taskList + currTimeTaskIndex);
+}
+#endif
+
+#ifdef CYCLIC_TABLE
+// back to the sorted list, every task keeps its next release; the running task is linked by the scheduler
+static void __ThawCyclicTable(void)
+{
+    u32 num   = cyclicNum;
+    cyclicNum = 0;
+    for (u32 i = 0; i < num; ++i) {
+        Task *task = taskList + cyclicTable[i].task;
+        if (cyclicTable[i].offset < __TaskInterval(task) && task->curr != currExecTaskIndex) { // first slot of the task
+            __LinkTimebasedTaskNode(task);
+        }
+    }
+}
+
+static inline u32 __GetGcd(u32 a, u32 b)
+{
+    while (b) {
+        u32 r = a % b;
+        a     = b;
+        b     = r;
+    }
+    return a;
+}
+
+static inline bool __FreezeTasks(void)
+{
+    if (currExecTaskIndex != __EndOfTaskList && __TaskType(taskList + currExecTaskIndex) != TASKTYPE_EVENT) {
+        return false; // a running time-based task is in no list
+    }
+    __ThawCyclicTable();
+    if (currTimeTaskIndex == __EndOfTaskList) {
+        return false;
+    }
+    u32 period = 1, num = 0;
+    for (TaskIndex i = currTimeTaskIndex; i != __EndOfTaskList; i = __TaskNext(taskList + i)) {
+        u32 interval = __TaskInterval(taskList + i);
+        if (__TaskType(taskList + i) != TASKTYPE_CIRCULATE || interval == 0) {
+            return false;
+        }
+        u32 factor = interval / __GetGcd(period, interval);
+        if (period > 0x7FFFFFFFU / factor) {
+            return false;
+        }
+        period *= factor;
+    }
+    for (TaskIndex i = currTimeTaskIndex; i != __EndOfTaskList; i = __TaskNext(taskList + i)) {
+        num += period / __TaskInterval(taskList + i);
+        if (num > CYCLIC_TABLE) {
+            return false;
+        }
+    }
+    // the earliest release starts the table, slots of equal offset keep the list order
+    u32 start = __TaskRunTime(taskList + currTimeTaskIndex);
+    num       = 0;
+    for (TaskIndex i = currTimeTaskIndex; i != __EndOfTaskList; i = __TaskNext(taskList + i)) {
+        u32 interval = __TaskInterval(taskList + i);
+        for (u32 offset = (__TaskRunTime(taskList + i) - start) % interval; offset < period; offset += interval) {
+            u32 pos = num++;
+            while (pos > 0 && cyclicTable[pos - 1].offset > offset) {
+                cyclicTable[pos] = cyclicTable[pos - 1];
+                --pos;
+            }
+            cyclicTable[pos] = (CyclicSlot){offset, i};
+        }
+    }
+    currTimeTaskIndex = __EndOfTaskList;
+    cyclicNum         = num;
+    cyclicCursor      = 0;
+    cyclicStart       = start;
+    cyclicPeriod      = period;
+    return true;
+}
+
+bool System_FreezeTasks(void)
+{
+    __LockScheduler();
+    bool ret = __FreezeTasks();
+    __UnlockScheduler();
+    return ret;
+}
+
+bool System_IsFrozen(void)
+{
+    __LockScheduler();
+    bool ret = cyclicNum != 0;
+    __UnlockScheduler();
+    return ret;
+}
+#endif
+#endif
+
+#ifdef SMP_CORE_NUM
+// takes the oldest unpinned task of the highest priority from another core
+static inline TaskIndex __StealReadyTaskNode(void)
+{
+    for (u8 i = 1; i < SMP_CORE_NUM; ++i) {
+        u8 queue = (u8)((currCoreId + i) % SMP_CORE_NUM);
+        for (u32 bitmap = readyBitmap[queue]; bitmap; bitmap &= bitmap - 1) {
+            TaskIndex index = readyHead[queue][__CountTrailingZeros(bitmap)];
+            while (index != __EndOfTaskList && taskList[index].affinity != SMP_ANY_CORE) {
+                index = __TaskNext(taskList + index);
+            }
+            if (index != __EndOfTaskList) {
+                __UnlinkReadyTaskNode(taskList + index);
+                return index;
+            }
+        }
+    }
+    return __EndOfTaskList;
+}
+#endif
+
+#ifdef TASK_PRIORITY_NUM
+// moves every expired task to its ready queue, then takes the head of the highest priority one
+static inline TaskIndex __PopReadyTaskNode(u32 currTick)
+{
+    TaskIndex index;
+    while ((index = __PopTimebasedTaskNode(currTick)) != __EndOfTaskList) {
+#ifdef SMP_CORE_NUM
+        Task *task = taskList + index;
+        task->core = task->affinity == SMP_ANY_CORE ? currCoreId : task->affinity;
+#endif
+        __PushReadyTaskNode(taskList + index);
+    }
+#ifdef SMP_CORE_NUM
+    u8 queue = currCoreId;
+    if (readyBitmap[queue] == 0) {
+        return __StealReadyTaskNode();
+    }
+#else
+    u8 queue = 0;
+    if (readyBitmap[queue] == 0) {
+        return __EndOfTaskList;
+    }
+#endif
+    index = readyHead[queue][__CountTrailingZeros(readyBitmap[queue])];
+    __UnlinkReadyTaskNode(taskList + index);
+    return index;
+}
+#endif
+
+#ifdef TASK_PROFILE
+// bucket 0 counts on-time starts, bucket n counts starts 2^(n-1) ~ 2^n-1 ticks late
+static inline u8 __GetLatenessBucket(u32 lateness)
+{
+    u8 bucket = 0;
+#if TASK_PROFILE > 1
+    while (lateness && bucket < TASK_PROFILE - 1) {
+        lateness >>= 1;
+        ++bucket;
+    }
+#else
+    (void)lateness;
+#endif
+    return bucket;
+}
+
+static inline void __RecordTaskProfile(Task *task, u32 startTick, u32 endTick)
+{
+    TaskProfile *profile = taskProfile + task->curr;
+    u32 execTime         = endTick - startTick;
+    profile->runCount++;
+    profile->execTotal += execTime;
+    if (execTime < profile->execMin) {
+        profile->execMin = execTime;
+    }
+    if (execTime > profile->execMax) {
+        profile->execMax = execTime;
+    }
+    if (__TaskType(task) != TASKTYPE_EVENT) {
+        s32 lateness = (s32)(startTick - __TaskRunTime(task));
+        profile->lateness[__GetLatenessBucket(lateness > 0 ? (u32)lateness : 0)]++;
+    }
+    busyTicks += execTime;
+}
+#endif
+
+// the scheduler lock is released while the task body runs
+static inline void __ExecuteTaskFunc(Task *task, u32 param, u16 state)
+{
+#ifdef TASK_PROFILE
+    u32 startTick = System_GetCurrTick();
+#endif
+    __TRACE(TRACE_TASK_START, task->curr);
+#ifdef SMP_CORE_NUM
+    task->running = true;
+    System_Unlock();
+    __TaskFunc(task)(param, state);
+    System_Lock();
+    task->running = false;
+#else
+    __TaskFunc(task)(param, state);
+#endif
+    __TRACE(TRACE_TASK_END, task->curr);
+#ifdef TASK_PROFILE
+    __RecordTaskProfile(task, startTick, System_GetCurrTick());
+#endif
+}
+
+static inline void __ResetTaskExecuteEnv(void)
+{
+    taskFlag  = 0x0000;
+    taskDelay = 0;
+}
+
+#ifdef TASK_OVERRUN
+// a periodic task finishing after its next release has missed periods, which its policy catches up, skips or coalesces
+static inline void __HandleTaskOverrun(Task *task)
+{
+    u32 interval = __TaskInterval(task);
+    u32 late     = System_GetCurrTick() - __TaskRunTime(task);
+    u32 missed   = 0;
+    if ((s32)late > 0 && interval != 0) {
+        missed = (late + interval - 1) / interval; // releases already in the past
+        task->overrunNum++;
+    }
+    switch (task->overrunPolicy) {
+    case OVERRUN_SKIP:
+        __TaskRunTime(task) += missed * interval;
+        break;
+    case OVERRUN_COALESCE:
+        if (missed) {
+            __TaskRunTime(task) += (missed - 1) * interval; // the last missed release runs at once
+        }
+        task->info.timebased.count = missed ? missed - 1 : 0;
+        break;
+    default:
+        return;
+    }
+#ifdef TASK_STAGGER
+    if (missed) {
+        __MoveTaskStagger(task);
+    }
+#endif
+}
+#endif
+
+// due tick requested by Task_Delay (counted from base) or Task_DelayUntil
+static inline u32 __GetDelayedTick(u32 base)
+{
+    return taskFlag & FLAG_UNTIL_MASK ? taskDelay : base + taskDelay;
+}
+
+#ifdef ENABLE_EVENT_TASK
+static inline bool __IsEventParamInvalid(Event *event)
+{
+    if (event == NULL) {
+        return true;
+    }
+    const Event *end = eventList + EVENT_MAX_NUM - 1;
+    return event < eventList || event > end || event->enable == false;
+}
+
+static inline u16 __HashSubscribeKey(Event *event, u16 signal)
+{
+    return (u16)((signal + (u32)(event - eventList) * 0x9E37U) & (SUB_BUCKET_NUM - 1));
+}
+
+static inline void __LinkEventTaskNode(Task *task)
+{
+    if (task->info.eventbased.suspend) {
+        return;
+    }
+    if (task->info.eventbased.delay) {
+        __LinkTimebasedTaskNode(task);
+        return;
+    }
+    u16 bucket                 = __HashSubscribeKey(__TaskEvent(task), task->info.eventbased.signal);
+    __TaskNext(task)           = __EndOfTaskList;
+    task->info.eventbased.prev = subBucketTail[bucket];
+    if (subBucketTail[bucket] == __EndOfTaskList) {
+        subBucketHead[bucket] = task->curr;
+    } else {
+        __TaskNext(taskList + subBucketTail[bucket]) = task->curr;
+    }
+    subBucketTail[bucket] = task->curr;
+}
+
+static inline void __UnlinkEventTaskNode(Task *task)
+{
+    if (task->info.eventbased.suspend) {
+        return;
+    }
+    if (task->info.eventbased.delay) {
+        __UnlinkTimebasedTaskNode(task);
+        return;
+    }
+    u16 bucket = __HashSubscribeKey(__TaskEvent(task), task->info.eventbased.signal);
+    if (evtNextTaskIndex == task->curr) {
+        evtNextTaskIndex = __TaskNext(task);
+    }
+    if (task->info.eventbased.prev == __EndOfTaskList) {
+        subBucketHead[bucket] = __TaskNext(task);
+    } else {
+        __TaskNext(taskList + task->info.eventbased.prev) = __TaskNext(task);
+    }
+    if (__TaskNext(task) == __EndOfTaskList) {
+        subBucketTail[bucket] = task->info.eventbased.prev;
+    } else {
+        taskList[__TaskNext(task)].info.eventbased.prev = task->info.eventbased.prev;
+    }
+    __TaskNext(task) = __EndOfTaskList;
+}
+
+static inline void __DeleteEventTask(Task *task)
+{
+    __UnlinkEventTaskNode(task);
+    __TaskEvent(task)->subNum--;
+    __FreeTaskNode(task);
+}
+
+static inline void __HandleEventTaskFlag(Task *task)
+{
+    if (taskFlag & FLAG_CLOSE_MASK) {
+        __TRACE(TRACE_TASK_KILL, task->curr);
+        __DeleteEventTask(task);
+    } else if (taskFlag & (FLAG_SUSPEND_MASK | FLAG_DELAY_MASK)) {
+        __UnlinkEventTaskNode(task);
+        if (taskFlag & FLAG_SUSPEND_MASK) {
+            __TRACE(TRACE_TASK_SUSPEND, task->curr);
+            task->info.eventbased.suspend = true;
+        } else {
+            task->info.eventbased.delay = true;
+            __TaskRunTime(task)         = __GetDelayedTick(System_GetCurrTick());
+        }
+        __LinkEventTaskNode(task);
+    }
+}
+#endif
+
+#ifdef ISR_EVENT_QUEUE
+static inline bool __SetEvent(Event *event, u16 signal, u32 value);
+
+static void __DrainIsrEventQueue(void)
+{
+    for (;;) {
+        IsrEventCell *cell = isrQueue + (isrQueueHead & ISR_QUEUE_MASK);
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) != isrQueueHead + 1U) {
+            return;
+        }
+        Event *event = eventList + cell->event;
+        u16 signal   = cell->signal;
+        u32 value    = cell->value;
+        atomic_store_explicit(&cell->seq, isrQueueHead + ISR_EVENT_QUEUE, memory_order_release);
+        ++isrQueueHead;
+        if (__SetEvent(event, signal, value) == false) {
+            ++isrDropNum; // the producer was told true, it can only see the drop here
+        }
+    }
+}
+#endif
+
+#ifdef TASK_GROUP_NUM
+// parks the tasks of a group found in a singly linked list, returns the new tail
+static inline TaskIndex __ParkGroupChain(TaskIndex *head, u8 group)
+{
+    TaskIndex prev = __EndOfTaskList, curr = *head;
+    while (curr != __EndOfTaskList) {
+        Task *task     = taskList + curr;
+        TaskIndex next = __TaskNext(task);
+        if (task->group == group) {
+            if (prev == __EndOfTaskList) {
+                *head = next;
+            } else {
+                __TaskNext(taskList + prev) = next;
+            }
+#ifdef TASK_PRIORITY_NUM
+            task->ready = false;
+#endif
+            __ParkTaskNode(task);
+        } else {
+            prev = curr;
+        }
+        curr = next;
+    }
+    return prev;
+}
+
+// moves every linked time-based task of a group to its parked list: one pass per singly linked list, the
+// wheel slots are popped member by member
+static void __ParkGroupTaskNodes(u8 group)
+{
+#ifdef TASK_PRIORITY_NUM
+    for (u8 priority = 0; priority < TASK_PRIORITY_NUM; ++priority) {
+        readyTail[0][priority] = __ParkGroupChain(&readyHead[0][priority], group);
+        if (readyHead[0][priority] == __EndOfTaskList) {
+            readyBitmap[0] &= ~(1U << priority);
+        }
+    }
+#endif
+#ifdef TIMING_WHEEL
+    for (TaskIndex i = groupHead[group]; i != __EndOfTaskList; i = taskList[i].groupNext) {
+        if (taskList[i].slot != WHEEL_NONE_SLOT) {
+            __PopWheelSlot(taskList + i);
+            __ParkTaskNode(taskList + i);
+        }
+    }
+#else
+#ifdef CYCLIC_TABLE
+    __ThawCyclicTable(); // the task set changes
+#endif
+    __ParkGroupChain(&currTimeTaskIndex, group);
+#endif
+}
+
+// frees every member of a group, including individually suspended ones
+static void __KillTaskGroup(u8 group)
+{
+    __ParkGroupTaskNodes(group);
+    groupParked[group] = __EndOfTaskList;
+    TaskIndex curr     = groupHead[group];
+    while (curr != __EndOfTaskList) {
+        Task *task = taskList + curr;
+        curr       = task->groupNext;
+        if (task->curr == currExecTaskIndex) {
+            taskFlag |= FLAG_CLOSE_MASK; // closes when it returns
+            continue;
+        }
+        __TRACE(TRACE_TASK_KILL, task->curr);
+#ifdef ENABLE_EVENT_TASK
+        if (__TaskType(task) == TASKTYPE_EVENT) {
+            if (task->parked == false) {
+                __UnlinkEventTaskNode(task);
+            }
+            __TaskEvent(task)->subNum--;
+        }
+#endif
+        __FreeTaskNode(task);
+    }
+    groupEnable |= 1U << group; // empty again, tasks that join later run
+}
+
+// relinks the parked tasks of a resumed group, each runs once now and a periodic task keeps its phase
+static void __WakeTaskGroup(u8 group)
+{
+    u32 currTick = System_GetCurrTick();
+    while (groupParked[group] != __EndOfTaskList) {
+        Task *task         = taskList + groupParked[group];
+        groupParked[group] = __TaskNext(task);
+        task->parked       = false;
+        if (__TaskType(task) == TASKTYPE_CIRCULATE) {
+            u32 interval = __TaskInterval(task);
+            if (interval != 0) {
+                __TaskRunTime(task) += (currTick - __TaskRunTime(task)) / interval * interval; // drops the missed periods
+            }
+#ifdef TASK_STAGGER
+            __LoadTaskStagger(task);
+#endif
+        }
+        __LinkTimebasedTaskNode(task);
+    }
+}
+
+// pops the next expired task of an enabled group into currExecTaskIndex, parking the others on the way
+static inline void __PopEnabledTaskNode(u32 currTick)
+{
+    for (;;) {
+#ifdef TASK_PRIORITY_NUM
+        currExecTaskIndex = __PopReadyTaskNode(currTick);
+#else
+        currExecTaskIndex = __PopTimebasedTaskNode(currTick);
+#endif
+        if (currExecTaskIndex == __EndOfTaskList || __IsTaskGroupEnabled(taskList + currExecTaskIndex)) {
+            return;
+        }
+#ifdef CYCLIC_TABLE
+        __ThawCyclicTable(); // the task leaves its slots
+#endif
+        __ParkTaskNode(taskList + currExecTaskIndex);
+    }
+}
+#endif
+
+#ifdef TICKLESS_IDLE
+static inline void __SleepUntilNextTick(void)
+{
+    if (looping == false) { // ended by an event task or the idle hook, nothing would wake us
+        return;
+    }
+#ifdef ENABLE_EVENT_TASK
+    if (evtQueueSize) {
+        return;
+    }
+#endif
+#ifdef ISR_EVENT_QUEUE
+    if (atomic_load_explicit(&isrQueue[isrQueueHead & ISR_QUEUE_MASK].seq, memory_order_acquire) == isrQueueHead + 1U) {
+        return;
+    }
+#endif
+    u32 currTick = System_GetCurrTick(), nextTick = currTick + 0x7FFFFFFFU;
+    if (__IsTimebasedListEmpty() == false) {
+        nextTick = __GetNextTimebasedTick();
+        if ((s32)(nextTick - currTick) <= 0) {
+            return;
+        }
+    }
+    System_SleepUntil(nextTick);
+}
+#endif
+
+#ifdef VIRTUAL_TIME
+u32 System_GetCurrTick(void)
+{
+    return virtualTick;
+}
+
+// jumps over idle time to the next time-based task, but not past endTick
+// returns false if nothing is left to run before endTick
+static bool __AdvanceVirtualTick(u32 endTick)
+{
+#ifdef ENABLE_EVENT_TASK
+    if (evtQueueSize) {
+        return true; // posted during the last pass, still due at the current tick
+    }
+#endif
+    if (__IsTimebasedListEmpty()) {
+        return false;
+    }
+    u32 nextTick = __GetNextTimebasedTick();
+    if ((s32)(nextTick - endTick) > 0 || (s32)(nextTick - virtualTick) <= 0) {
+        return false;
+    }
+    virtualTick = nextTick;
+    return true;
+}
+#endif
+
+#ifdef STATIC_TASK_TABLE
+// links every task of the table as if it had been created at the current tick, in table order
+static void __StartStaticTasks(void)
+{
+    u32 currTick = System_GetCurrTick();
+    for (TaskIndex i = 0; i < TASK_MAX_NUM; ++i) {
+        Task *task = taskList + i;
+        __InitTaskNode(task);
+        switch (__TaskType(task)) {
+        case TASKTYPE_CIRCULATE:
+#ifdef TASK_EDF
+            __TaskDeadline(task) = __TaskInterval(task);
+#endif
+#ifdef TASK_STAGGER
+            __TaskRunTime(task) = currTick + __GetStaggeredOffset(currTick, __TaskInterval(task));
+            __LoadTaskStagger(task);
+#else
+            __TaskRunTime(task) = currTick + __TaskInterval(task);
+#endif
+            __LinkTimebasedTaskNode(task);
+            break;
+        case TASKTYPE_DISPOSABLE:
+            __TaskRunTime(task) = currTick + __TaskInterval(task);
+            __LinkTimebasedTaskNode(task);
+            break;
+#ifdef ENABLE_EVENT_TASK
+        case TASKTYPE_EVENT:
+            task->info.eventbased.signal = staticTaskTable[i].signal;
+#ifdef SMP_CORE_NUM
+            task->affinity = 0; // event tasks stay on the dispatching core
+#endif
+            __LinkEventTaskNode(task);
+            __TaskEvent(task)->subNum++;
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+}
+#endif
+
+void System_Init(void)
+{
+#ifdef VIRTUAL_TIME
+    virtualTick = 0;
+#endif
+    looping           = false;
+    currExecTaskIndex = __EndOfTaskList;
+#ifdef STATIC_TASK_TABLE
+    for (TaskIndex i = 0; i < TASK_MAX_NUM; ++i) {
+        taskList[i].curr = i;
+#ifdef TIMING_WHEEL
+        taskList[i].slot = WHEEL_NONE_SLOT;
+#endif
+    }
+#else
+    freeTaskIndex = TASK_MAX_NUM - 1;
+    for (TaskIndex i = 0; i < TASK_MAX_NUM; ++i) {
+        taskList[i].curr         = i;
+        __TaskNext(taskList + i) = i - 1; // (TaskIndex)-1 terminates the free list
+#ifdef TIMING_WHEEL
+        taskList[i].slot = WHEEL_NONE_SLOT;
+#endif
+    }
+#endif
+#ifdef TIMING_WHEEL
+    wheelTime    = System_GetCurrTick();
+    wheelTaskNum = 0;
+    for (u8 i = 0; i <= WHEEL_DUE_SLOT; ++i) {
+        wheelSlot[i] = __EndOfTaskList;
+    }
+    for (u8 i = 0; i < WHEEL_LEVEL_NUM; ++i) {
+        wheelBitmap[i] = 0;
+    }
+#else
+    currTimeTaskIndex = __EndOfTaskList;
+#endif
+#ifdef CYCLIC_TABLE
+    cyclicNum = 0;
+#endif
+#ifdef TASK_STAGGER
+    for (u32 i = 0; i < TASK_STAGGER; ++i) {
+        staggerLoad[i] = 0;
+    }
+#endif
+#ifdef TASK_GROUP_NUM
+    groupEnable = 0xFFFFFFFFU;
+    for (u8 i = 0; i < TASK_GROUP_NUM; ++i) {
+        groupHead[i]   = __EndOfTaskList;
+        groupParked[i] = __EndOfTaskList;
+    }
+#endif
+#ifdef TASK_PRIORITY_NUM
+    for (u8 i = 0; i < READY_QUEUE_NUM; ++i) {
+        readyBitmap[i] = 0;
+        for (u8 j = 0; j < TASK_PRIORITY_NUM; ++j) {
+            readyHead[i][j] = __EndOfTaskList;
+            readyTail[i][j] = __EndOfTaskList;
+        }
+    }
+#endif
+#ifdef SMP_CORE_NUM
+    loopCoreMask = 0;
+#endif
+#ifdef TASK_PROFILE
+    busyTicks     = 0;
+    loadStartTick = System_GetCurrTick();
+#endif
+#ifdef TRACE_BUFFER
+    traceHead = 0;
+    traceTail = 0;
+#endif
+#ifdef IDLE_HOOK_FUNCITON
+    idleTask = NULL;
+#endif
+#ifdef TASK_KILL_HOOK
+    killHook = NULL;
+#endif
+#ifdef ENABLE_EVENT_TASK
+#ifdef STATIC_TASK_TABLE
+    for (EvtIndex i = 0; i < EVENT_MAX_NUM; ++i) {
+        eventList[i] = (Event){.enable = true}; // every event of the table exists from the start
+    }
+#else
+    freeEvtIndex = 0;
+    for (EvtIndex i = 0; i < EVENT_MAX_NUM; ++i) {
+        eventList[i].enable = false;
+        eventList[i].queued = false;
+        eventList[i].value  = i + 1 < EVENT_MAX_NUM ? i + 1 : __EndOfEvtList;
+    }
+#endif
+    evtQueueHead = 0;
+    evtQueueSize = 0;
+#ifdef PAYLOAD_NUM
+    freePayloadIndex = 0;
+    for (PayloadIndex i = 0; i < PAYLOAD_NUM; ++i) {
+        payloadPool[i].next = i + 1 < PAYLOAD_NUM ? i + 1 : __EndOfPayload;
+    }
+#endif
+    for (u16 i = 0; i < SUB_BUCKET_NUM; ++i) {
+        subBucketHead[i] = __EndOfTaskList;
+        subBucketTail[i] = __EndOfTaskList;
+    }
+    evtNextTaskIndex = __EndOfTaskList;
+#ifdef EVENT_BUDGET
+    pausedEvent = NULL;
+    budgetStats = (EventBudgetStats){0};
+#endif
+#ifdef ISR_EVENT_QUEUE
+    for (u32 i = 0; i < ISR_EVENT_QUEUE; ++i) {
+        atomic_init(&isrQueue[i].seq, i);
+    }
+    atomic_init(&isrQueueTail, 0);
+    isrQueueHead = 0;
+    isrDropNum   = 0;
+#endif
+#endif
+#ifdef STATIC_TASK_TABLE
+    __StartStaticTasks();
+#endif
+}
+
+#ifdef ENABLE_EVENT_TASK
+#ifdef PAYLOAD_NUM
+static inline void __FreePayloadBlock(PayloadIndex index)
+{
+    if (index != __EndOfPayload) {
+        payloadPool[index].next = freePayloadIndex;
+        freePayloadIndex        = index;
+    }
+}
+
+static inline bool __IsPayloadParamInvalid(void *payload)
+{
+    uintptr_t offset = (uintptr_t)payload - (uintptr_t)payloadPool;
+    return payload == NULL || (uintptr_t)payload < (uintptr_t)payloadPool || offset >= sizeof(payloadPool) || offset % sizeof(PayloadBlock) != 0;
+}
+#endif
+
+// runs the subscribers of (event, signal) in subscription order, or from evtNextTaskIndex when resuming
+// returns false when the budget ran out, evtNextTaskIndex is then the next subscriber to run
+static inline bool __DispatchEventSignal(Event *event, u16 signal, u32 value, bool resume)
+{
+    register Task *tempTask;
+    currExecTaskIndex = resume ? evtNextTaskIndex : subBucketHead[__HashSubscribeKey(event, signal)];
+    while (currExecTaskIndex != __EndOfTaskList) {
+        tempTask         = taskList + currExecTaskIndex;
+        evtNextTaskIndex = __TaskNext(tempTask);
+        if (__TaskEvent(tempTask) == event && tempTask->info.eventbased.signal == signal && __IsTaskGroupEnabled(tempTask)) {
+#ifdef EVENT_BUDGET
+            if (handlerBudget == 0) {
+                evtNextTaskIndex  = currExecTaskIndex;
+                currExecTaskIndex = __EndOfTaskList;
+                return false;
+            }
+            --handlerBudget;
+            ++budgetStats.handlerNum;
+#endif
+            __ResetTaskExecuteEnv();
+            __ExecuteTaskFunc(tempTask, value, signal);
+            if (taskFlag) {
+                __HandleEventTaskFlag(tempTask);
+            }
+        }
+        currExecTaskIndex = evtNextTaskIndex;
+    }
+    evtNextTaskIndex = __EndOfTaskList;
+    return true;
+}
+
+#ifdef EVENT_MAILBOX
+// delivers one message, its payload is released once every subscriber has seen it
+static inline bool __DispatchEventMessage(Event *event, EventMessage message, bool resume)
+{
+#ifdef PAYLOAD_NUM
+    currPayload = message.payload == __EndOfPayload ? NULL : payloadPool + message.payload;
+    bool done   = __DispatchEventSignal(event, message.signal, message.value, resume);
+    currPayload = NULL;
+    if (done) {
+        __FreePayloadBlock(message.payload);
+    }
+    return done;
+#else
+    return __DispatchEventSignal(event, message.signal, message.value, resume);
+#endif
+}
+
+// delivers the messages queued so far, one subscriber call each, later posts queue the event again
+static inline bool __DispatchEventBatch(Event *event, u8 batch)
+{
+    EventMessage *mailbox = eventMailbox[event - eventList];
+    for (; batch && event->msgSize; --batch) {
+        EventMessage message = mailbox[event->msgHead];
+        event->msgHead       = event->msgHead + 1 < EVENT_MAILBOX ? event->msgHead + 1 : 0;
+        --event->msgSize;
+        if (__DispatchEventMessage(event, message, false) == false) {
+#ifdef EVENT_BUDGET
+            pausedEvent   = event;
+            pausedMessage = message;
+            pausedBatch   = batch - 1;
+#endif
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef EVENT_BUDGET
+// finishes the delivery cut short in the last pass
+static inline bool __ResumeEventDispatch(void)
+{
+    Event *event = pausedEvent;
+    pausedEvent  = NULL;
+#ifdef EVENT_MAILBOX
+    if (__DispatchEventMessage(event, pausedMessage, true) == false) {
+        pausedEvent = event;
+        return false;
+    }
+    return __DispatchEventBatch(event, pausedBatch);
+#else
+    if (__DispatchEventSignal(event, pausedMessage.signal, pausedMessage.value, true) == false) {
+        pausedEvent = event;
+        return false;
+    }
+    if (event->queued == false) {
+        event->signal = 0;
+    }
+    return true;
+#endif
+}
+#endif
+
+// returns true if the budget ran out with events left
+static bool __DispatchEventQueue(void)
+{
+#ifdef SMP_CORE_NUM
+    if (currCoreId != 0) {
+        return false; // a single dispatcher keeps the subscription order and the shared cursor
+    }
+#endif
+#ifdef ISR_EVENT_QUEUE
+    __DrainIsrEventQueue();
+#endif
+#ifdef EVENT_BUDGET
+    handlerBudget = EVENT_BUDGET;
+    if (pausedEvent && __ResumeEventDispatch() == false) {
+        ++budgetStats.hitNum;
+        return true;
+    }
+#endif
+    register Event *tempEvent;
+    while (evtQueueSize) {
+        __TRACE_IDLE(false);
+        __TRACE(TRACE_EVENT_DISPATCH, eventQueue[evtQueueHead]);
+        tempEvent    = eventList + eventQueue[evtQueueHead];
+        evtQueueHead = evtQueueHead + 1 < EVENT_MAX_NUM ? evtQueueHead + 1 : 0;
+        --evtQueueSize;
+        // the event may be posted again by its own subscribers
+        tempEvent->queued = false;
+#ifdef EVENT_MAILBOX
+        if (__DispatchEventBatch(tempEvent, tempEvent->msgSize) == false) {
+#ifdef EVENT_BUDGET
+            ++budgetStats.hitNum;
+#endif
+            return true;
+        }
+#else
+#ifdef EVENT_BUDGET
+        pausedMessage = (EventMessage){.value = tempEvent->value, .signal = tempEvent->signal}; // a repost overwrites the event
+#endif
+        if (__DispatchEventSignal(tempEvent, tempEvent->signal, tempEvent->value, false) == false) {
+#ifdef EVENT_BUDGET
+            pausedEvent = tempEvent;
+            ++budgetStats.hitNum;
+#endif
+            return true;
+        }
+        if (tempEvent->queued == false) {
+            tempEvent->signal = 0;
+        }
+#endif
+    }
+    return false;
+}
+#endif
+
+// one scheduler pass: the pending events (up to EVENT_BUDGET task calls), then at most one expired time-based task
+// returns false if no time-based task was ready and no event was left, the scheduler lock is released either way
+static bool __ScheduleOnce(void)
+{
+    register Task *tempTask;
+    __LockScheduler();
+#ifdef EVENT_BUDGET
+    bool eventsLeft = __DispatchEventQueue();
+#elif defined(ENABLE_EVENT_TASK)
+    __DispatchEventQueue();
+#endif
+#ifdef TASK_GROUP_NUM
+    __PopEnabledTaskNode(System_GetCurrTick());
+#elif defined(TASK_PRIORITY_NUM)
+    currExecTaskIndex = __PopReadyTaskNode(System_GetCurrTick());
+#else
+    currExecTaskIndex = __PopTimebasedTaskNode(System_GetCurrTick());
+#endif
+    if (currExecTaskIndex == __EndOfTaskList) {
+#ifdef EVENT_BUDGET
+        if (eventsLeft) {
+            __UnlockScheduler();
+            return true; // not idle, the next pass goes on with the events
+        }
+#endif
+        __TRACE_IDLE(true);
+        __UnlockScheduler();
+        return false;
+    }
+    __TRACE_IDLE(false);
+    tempTask = taskList + currExecTaskIndex;
+    __ResetTaskExecuteEnv();
+    switch (__TaskType(tempTask)) {
+    case TASKTYPE_CIRCULATE:
+        __ExecuteTaskFunc(tempTask, tempTask->info.timebased.count, tempTask->execState);
+        if (taskFlag) {
+#ifdef CYCLIC_TABLE
+            __ThawCyclicTable(); // the task left its slots
+#endif
+            if (taskFlag & FLAG_CLOSE_MASK) {
+                __TRACE(TRACE_TASK_KILL, tempTask->curr);
+                __FreeTaskNode(tempTask);
+                break;
+            } else if (taskFlag & FLAG_SUSPEND_MASK) {
+                __TRACE(TRACE_TASK_SUSPEND, tempTask->curr);
+#ifdef TASK_STAGGER
+                __UnloadTaskStagger(tempTask); // a suspended task has no releases to count
+#endif
+                break;
+            } else if (taskFlag & FLAG_DELAY_MASK) {
+                __TaskRunTime(tempTask) = __GetDelayedTick(__TaskRunTime(tempTask));
+#ifdef TASK_STAGGER
+                __MoveTaskStagger(tempTask);
+#endif
+            }
+        } else {
+            tempTask->info.timebased.count++;
+            __TaskRunTime(tempTask) += __TaskInterval(tempTask);
+            tempTask->execState     = 0;
+#ifdef TASK_OVERRUN
+            __HandleTaskOverrun(tempTask);
+#endif
+        }
+        __LinkTimebasedTaskNode(tempTask);
+        break;
+    case TASKTYPE_DISPOSABLE:
+        __ExecuteTaskFunc(tempTask, 0, tempTask->execState);
+        if (taskFlag & FLAG_DELAY_MASK) {
+            __TaskRunTime(tempTask) = __GetDelayedTick(__TaskRunTime(tempTask));
+            __LinkTimebasedTaskNode(tempTask);
+        } else {
+            __FreeTaskNode(tempTask);
+        }
+        break;
+#ifdef ENABLE_EVENT_TASK
+    case TASKTYPE_EVENT:
+        tempTask->info.eventbased.delay = false;
+        __LinkEventTaskNode(tempTask);
+        __ExecuteTaskFunc(tempTask, 0, 0);
+        if (taskFlag) {
+            __HandleEventTaskFlag(tempTask);
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+    currExecTaskIndex = __EndOfTaskList;
+    __UnlockScheduler();
+    return true;
+}
+
+void System_Loop(void)
+{
+#ifdef SMP_CORE_NUM
+    System_Lock();
+    if (loopCoreMask == SMP_CORE_MASK) {
+        System_Unlock();
+        return;
+    }
+    if (loopCoreMask == 0) {
+        looping = true;
+    }
+    currCoreId = __CountTrailingZeros(~loopCoreMask);
+    loopCoreMask |= 1U << currCoreId;
+    System_Unlock();
+#else
+    if (looping == true) {
+        return;
+    }
+    looping = true;
+#endif
+#ifdef IDLE_HOOK_FUNCITON
+    u32 lastIdleTick = System_GetCurrTick();
+#endif
+#ifdef PORT_POLL
+    u32 busyPass = 0;
+#endif
+#ifdef SMP_CORE_NUM
+    u32 idleSpin = 0;
+#endif
+    while (looping) {
+        if (__ScheduleOnce()) {
+#ifdef SMP_CORE_NUM
+            idleSpin = 0;
+#endif
+#ifdef PORT_POLL
+            if (++busyPass == PORT_POLL) {
+                busyPass = 0;
+                System_PortPoll(); // a loop that never idles would not see the inputs otherwise
+            }
+#endif
+            continue;
+        }
+#ifdef AUTO_SLEEP
+        if (looping && __IsTimebasedListEmpty()) {
+            System_Sleep();
+            continue;
+        }
+#endif
+#ifdef IDLE_HOOK_FUNCITON
+        if (idleTask) {
+            u32 currIdleTick = System_GetCurrTick();
+            idleTask(currIdleTick, lastIdleTick);
+            lastIdleTick = currIdleTick;
+        }
+#endif
+#ifdef TICKLESS_IDLE
+        __SleepUntilNextTick();
+#endif
+#ifdef VIRTUAL_TIME
+        if (__AdvanceVirtualTick(virtualTick + 0x7FFFFFFFU) == false) {
+            looping = false; // nothing left that could become ready
+        }
+#endif
+#ifdef SMP_CORE_NUM
+        __IdleBackoff(&idleSpin);
+#endif
+    }
+#ifdef SMP_CORE_NUM
+    System_Lock();
+    loopCoreMask &= ~(1U << currCoreId);
+    System_Unlock();
+#endif
+}
+
+#ifdef IDLE_HOOK_FUNCITON
+void System_RegisterIdleTask(TaskMainFunc func)
+{
+    idleTask = func;
+}
+#endif
+
+#ifdef TASK_KILL_HOOK
+void System_RegisterKillHook(TaskKillHook hook)
+{
+    __LockScheduler();
+    killHook = hook;
+    __UnlockScheduler();
+}
+#endif
+
+void System_EndLoop(void)
+{
+    looping = false;
+}
+
+#ifdef VIRTUAL_TIME
+bool System_RunUntil(u32 tick)
+{
+    if (looping == true) {
+        return false;
+    }
+    looping = true;
+    while (looping) {
+        if (__ScheduleOnce() == false && __AdvanceVirtualTick(tick) == false) {
+            break;
+        }
+    }
+    if (looping == false) {
+        return false; // ended by System_EndLoop
+    }
+    looping = false;
+    if ((s32)(tick - virtualTick) > 0) {
+        virtualTick = tick;
+    }
+    return true;
+}
+
+bool System_Step(void)
+{
+    if (looping == true) {
+        return false;
+    }
+    looping  = true;
+    bool ran = false;
+    do {
+#ifdef ENABLE_EVENT_TASK
+        ran = evtQueueSize != 0;
+#endif
+        ran = __ScheduleOnce() || ran;
+    } while (ran == false && __AdvanceVirtualTick(virtualTick + 0x7FFFFFFFU));
+    looping = false;
+    return ran;
+}
+#endif
+
+#ifdef STATIC_TASK_TABLE
+Task *System_GetStaticTask(u16 id)
+{
+    return id < TASK_MAX_NUM ? taskList + id : NULL;
+}
+#else
+static inline Task *__AddNewLoopTask(TaskMainFunc func, u32 interval, u32 offset)
+{
+    Task *t = __AllocTaskNode(TASKTYPE_CIRCULATE, func);
+    if (t) {
+        __TaskRunTime(t)           = System_GetCurrTick() + offset;
+        t->info.timebased.interval = interval;
+#ifdef TASK_EDF
+        __TaskDeadline(t) = interval;
+#endif
+#ifdef TASK_STAGGER
+        __LoadTaskStagger(t);
+#endif
+        __LinkTimebasedTaskNode(t);
+    }
+    return t;
+}
+
+Task *System_AddNewLoopTask(TaskMainFunc func, u32 interval)
+{
+    __LockScheduler();
+#ifdef TASK_STAGGER
+    Task *t = __AddNewLoopTask(func, interval, __GetStaggeredOffset(System_GetCurrTick(), interval));
+#else
+    Task *t = __AddNewLoopTask(func, interval, interval);
+#endif
+    __UnlockScheduler();
+    return t;
+}
+
+Task *System_AddNewLoopTaskAt(TaskMainFunc func, u32 interval, u32 offset)
+{
+    if (offset > 0x7FFFFFFFU) {
+        return NULL;
+    }
+    __LockScheduler();
+    Task *t = __AddNewLoopTask(func, interval, offset);
+    __UnlockScheduler();
+    return t;
+}
+
+static inline Task *__AddNewTempTask(TaskMainFunc func, u32 interval)
+{
+    Task *t = __AllocTaskNode(TASKTYPE_DISPOSABLE, func);
+    if (t) {
+        __TaskRunTime(t) = System_GetCurrTick() + interval;
+        __LinkTimebasedTaskNode(t);
+    }
+    return t;
+}
+
+Task *System_AddNewTempTask(TaskMainFunc func, u32 interval)
+{
+    __LockScheduler();
+    Task *t = __AddNewTempTask(func, interval);
+    __UnlockScheduler();
+    return t;
+}
+
+#ifdef ENABLE_EVENT_TASK
+static inline Task *__AddNewEventTask(TaskMainFunc func, Event *event, u16 signal)
+{
+    if (signal == 0 || __IsEventParamInvalid(event)) {
+        return NULL;
+    }
+    Task *t = __AllocTaskNode(TASKTYPE_EVENT, func);
+    if (t) {
+        t->info.eventbased.event  = (EvtIndex)(event - eventList);
+        t->info.eventbased.signal = signal;
+#ifdef SMP_CORE_NUM
+        t->affinity = 0; // event tasks stay on the dispatching core
+#endif
+        __LinkEventTaskNode(t);
+        event->subNum++;
+    }
+    return t;
+}
+
+Task *System_AddNewEventTask(TaskMainFunc func, Event *event, u16 signal)
+{
+    __LockScheduler();
+    Task *t = __AddNewEventTask(func, event, signal);
+    __UnlockScheduler();
+    return t;
+}
+#endif
+#endif
+
+static inline bool __SuspendTask(Task *task, u16 nextState)
+{
+    if (__IsTaskParamInvalid(task) || __TaskType(task) == TASKTYPE_DISPOSABLE || __IsTaskBusyOnOtherCore(task)) {
+        return false;
+    }
+    if (currExecTaskIndex == task->curr) {
+        taskFlag |= FLAG_SUSPEND_MASK;
+        return true;
+    }
+#ifdef ENABLE_EVENT_TASK
+    if (__TaskType(task) == TASKTYPE_EVENT) {
+        if (task->info.eventbased.suspend == false) {
+            __TRACE(TRACE_TASK_SUSPEND, task->curr);
+            __UnlinkEventTaskNode(task);
+            task->info.eventbased.suspend = true;
+            __LinkEventTaskNode(task);
+        }
+        return true;
+    }
+#endif
+    if (__UnlinkTimebasedTaskNode(task) == false) {
+        return false;
+    }
+    __TRACE(TRACE_TASK_SUSPEND, task->curr);
+#ifdef TASK_STAGGER
+    __UnloadTaskStagger(task);
+#endif
+    task->execState = nextState;
+    return true;
+}
+
+bool System_SuspendTask(Task *task, u16 nextState)
+{
+    __LockScheduler();
+    bool ret = __SuspendTask(task, nextState);
+    __UnlockScheduler();
+    return ret;
+}
+
+static inline bool __ResumeTask(Task *task, u16 execState, bool instance)
+{
+    if (__IsTaskParamInvalid(task) || __TaskType(task) == TASKTYPE_DISPOSABLE || __IsTaskBusyOnOtherCore(task)) {
+        return false;
+    }
+#ifdef ENABLE_EVENT_TASK
+    if (__TaskType(task) == TASKTYPE_EVENT) {
+        if (task->info.eventbased.suspend) {
+            __TRACE(TRACE_TASK_RESUME, task->curr);
+            __UnlinkEventTaskNode(task);
+            task->info.eventbased.suspend = false;
+            __LinkEventTaskNode(task);
+        }
+        return true;
+    }
+#endif
+    if (currExecTaskIndex == task->curr) {
+        return false; // not suspended, the scheduler relinks it when it returns
+    }
+    __TRACE(TRACE_TASK_RESUME, task->curr);
+    __UnlinkTimebasedTaskNode(task);
+    task->execState     = execState;
+    __TaskRunTime(task) = System_GetCurrTick() + (instance ? 0 : __TaskInterval(task));
+#ifdef TASK_STAGGER
+    __MoveTaskStagger(task);
+#endif
+    __LinkTimebasedTaskNode(task);
+    return true;
+}
+
+bool System_ResumeTask(Task *task, u16 execState, bool instance)
+{
+    __LockScheduler();
+    bool ret = __ResumeTask(task, execState, instance);
+    __UnlockScheduler();
+    return ret;
+}
+
+static inline bool __KillTask(Task *task)
+{
+    if (__IsTaskParamInvalid(task) || __IsTaskBusyOnOtherCore(task)) {
+        return false;
+    }
+    if (currExecTaskIndex == task->curr) {
+        taskFlag |= FLAG_CLOSE_MASK;
+        return true;
+    }
+    switch (__TaskType(task)) {
+    case TASKTYPE_CIRCULATE:
+    case TASKTYPE_DISPOSABLE: {
+        if (__UnlinkTimebasedTaskNode(task) == false) {
+            return false;
+        }
+        __TRACE(TRACE_TASK_KILL, task->curr);
+        __FreeTaskNode(task);
+        return true;
+    }
+#ifdef ENABLE_EVENT_TASK
+    case TASKTYPE_EVENT:
+        __TRACE(TRACE_TASK_KILL, task->curr);
+        __DeleteEventTask(task);
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool System_KillTask(Task *task)
+{
+    __LockScheduler();
+    bool ret = __KillTask(task);
+    __UnlockScheduler();
+    return ret;
+}
+
+#ifdef TASK_GROUP_NUM
+static inline bool __SetTaskGroup(Task *task, u8 group)
+{
+    if (__IsTaskParamInvalid(task) || (group >= TASK_GROUP_NUM && group != TASK_NO_GROUP)) {
+        return false;
+    }
+    if (task->parked) {
+        __UnparkTaskNode(task);
+        __LeaveTaskGroup(task);
+        __JoinTaskGroup(task, group);
+#ifdef TASK_STAGGER
+        if (__TaskType(task) == TASKTYPE_CIRCULATE) {
+            __LoadTaskStagger(task);
+        }
+#endif
+        __LinkTimebasedTaskNode(task); // still due, parked again if the new group is suspended
+    } else {
+        __LeaveTaskGroup(task);
+        __JoinTaskGroup(task, group);
+    }
+    return true;
+}
+
+bool System_SetTaskGroup(Task *task, u8 group)
+{
+    __LockScheduler();
+    bool ret = __SetTaskGroup(task, group);
+    __UnlockScheduler();
+    return ret;
+}
+
+// O(1): the tasks stay in their lists, the scheduler parks each one when it comes due
+bool System_SuspendGroup(u8 group)
+{
+    if (group >= TASK_GROUP_NUM) {
+        return false;
+    }
+    __LockScheduler();
+    groupEnable &= ~(1U << group);
+    __UnlockScheduler();
+    return true;
+}
+
+// O(parked tasks of the group)
+bool System_ResumeGroup(u8 group)
+{
+    if (group >= TASK_GROUP_NUM) {
+        return false;
+    }
+    __LockScheduler();
+    groupEnable |= 1U << group;
+    __WakeTaskGroup(group);
+    __UnlockScheduler();
+    return true;
+}
+
+// O(members of the group), plus one pass over the sorted time-based list without TIMING_WHEEL
+bool System_KillGroup(u8 group)
+{
+    if (group >= TASK_GROUP_NUM) {
+        return false;
     }
+    __LockScheduler();
+    __KillTaskGroup(group);
+    __UnlockScheduler();
+    return true;
 }
+#endif
 
-static inline bool __SetNextNodeOfPrevTaskNode(Task *task, TaskIndex startNode)
+#ifdef TASK_PRIORITY_NUM
+static inline bool __SetTaskPriority(Task *task, u8 priority)
 {
-    TaskIndex prev = __EndOfTaskList, curr = startNode;
-    while (curr != task->curr) {
-        prev = curr;
-        curr = taskList[curr].next;
-        if (curr == __EndOfTaskList) {
-            return true;
-        }
+    if (__IsTaskParamInvalid(task) || priority >= TASK_PRIORITY_NUM) {
+        return false;
     }
-    taskList[prev].next = task->next;
-    return false;
+    if (task->ready) {
+        __UnlinkReadyTaskNode(task);
+        task->priority = priority;
+        __PushReadyTaskNode(task);
+    } else {
+        task->priority = priority;
+    }
+    return true;
 }
 
-static inline void __ResetTaskExecuteEnv(void)
+bool System_SetTaskPriority(Task *task, u8 priority)
 {
-    taskFlag = 0x0000;
+    __LockScheduler();
+    bool ret = __SetTaskPriority(task, priority);
+    __UnlockScheduler();
+    return ret;
 }
+#endif
 
-#ifdef ENABLE_EVENT_TASK
-static inline bool __IsEventParamInvalid(Event *event)
+#ifdef TASK_OVERRUN
+static inline bool __SetTaskOverrun(Task *task, u8 policy)
 {
-    if (event == NULL) {
-        return true;
+    if (__IsTaskParamInvalid(task) || __TaskType(task) != TASKTYPE_CIRCULATE || policy > OVERRUN_COALESCE) {
+        return false;
     }
-    const Event *end = eventList + EVENT_MAX_NUM - 1;
-    return event < eventList || event > end || event->enable == false;
+    if ((policy == OVERRUN_COALESCE) != (task->overrunPolicy == OVERRUN_COALESCE)) {
+        task->info.timebased.count = 0; // count switches between run count and missed periods
+    }
+    task->overrunPolicy = policy;
+    return true;
 }
 
-static inline void __DeleteEventTask(Task *task)
+bool System_SetTaskOverrun(Task *task, u8 policy)
 {
-    Event *e = task->info.eventbased.event;
-    if (e->subList == task->curr) {
-        e->subList = task->next;
-    } else {
-        __SetNextNodeOfPrevTaskNode(task, e->subList);
-    }
-    __ClearTaskNode(task);
+    __LockScheduler();
+    bool ret = __SetTaskOverrun(task, policy);
+    __UnlockScheduler();
+    return ret;
 }
 
-static void __SystemEventHandlerTask(u32 count, u16 state)
-{
-    TaskIndex ti = __EndOfTaskList, ci = currExecTaskIndex;
-    for (EvtIndex ei = (EvtIndex)state; ei < EVENT_MAX_NUM; ++ei) {
-        if (eventList[ei].enable) {
-            ti = eventList[ei].subList;
-            while (ti != __EndOfTaskList) {
-                if (taskList[ti].info.eventbased.nextRunTime && taskList[ti].info.eventbased.nextRunTime <= System_GetCurrTick()) {
-                    currExecTaskIndex = ti;
-                    __ResetTaskExecuteEnv();
-                    taskList[ti].func(0, 0);
-                    taskList[ti].info.eventbased.nextRunTime = 0;
-                    if (taskFlag) {
-                        if (taskFlag & FLAG_CLOSE_MASK) {
-                            __DeleteEventTask(taskList + ti);
-                        } else if (taskFlag & FLAG_SUSPEND_MASK) {
-                            taskList[ti].info.eventbased.suspend = true;
-                        } else if (taskFlag & FLAG_DELAY_MASK) {
-                            taskList[ti].info.eventbased.nextRunTime = System_GetCurrTick() + (taskFlag & DELAY_TIME_MASK);
-                        }
-                    }
-                    currExecTaskIndex = ci;
-                    Task_Yield(ei);
-                    return;
-                }
-                ti = taskList[ti].next;
-            }
-        }
-    }
+u32 System_GetTaskOverrun(Task *task)
+{
+    __LockScheduler();
+    u32 num = __IsTaskParamInvalid(task) ? 0 : task->overrunNum;
+    __UnlockScheduler();
+    return num;
 }
 #endif
 
-void System_Init(void)
+#ifdef SMP_CORE_NUM
+static inline bool __SetTaskAffinity(Task *task, u8 core)
 {
-    looping           = false;
-    currTimeTaskIndex = __EndOfTaskList;
-    currExecTaskIndex = __EndOfTaskList;
-    for (TaskIndex i = 0; i < TASK_MAX_NUM; ++i) {
-        taskList[i].curr = i;
-        taskList[i].next = __EndOfTaskList;
+    if (__IsTaskParamInvalid(task) || __TaskType(task) == TASKTYPE_EVENT || (core >= SMP_CORE_NUM && core != SMP_ANY_CORE)) {
+        return false;
+    }
+    task->affinity = core;
+#if SMP_CORE_NUM > 1
+    if (task->ready && core != SMP_ANY_CORE && task->core != core) {
+        __UnlinkReadyTaskNode(task);
+        task->core = core;
+        __PushReadyTaskNode(task);
     }
-#ifdef IDLE_HOOK_FUNCITON
-    idleTask = NULL;
-#endif
-#ifdef ENABLE_EVENT_TASK
-    eventQueue[0] = __EndOfEvtList;
-    System_AddNewLoopTask(__SystemEventHandlerTask, 1);
 #endif
+    return true;
 }
 
-void System_Loop(void)
+bool System_SetTaskAffinity(Task *task, u8 core)
 {
-    if (looping == true) {
-        return;
-    }
-    looping          = true;
-    u32 lastIdleTick = System_GetCurrTick();
-    register Task *tempTask;
-#ifdef ENABLE_EVENT_TASK
-    register Event *tempEvent;
-#endif
-    while (looping) {
-#ifdef ENABLE_EVENT_TASK
-        for (EvtIndex i = 0; i < EVENT_MAX_NUM && eventQueue[i] != __EndOfEvtList; ++i) {
-            tempEvent         = eventList + eventQueue[i];
-            currExecTaskIndex = tempEvent->subList;
-            while (currExecTaskIndex != __EndOfTaskList) {
-                tempTask = taskList + currExecTaskIndex;
-                if (tempTask->info.eventbased.suspend == false && tempTask->info.eventbased.nextRunTime == 0 && tempTask->info.eventbased.signal == tempEvent->signal) {
-                    __ResetTaskExecuteEnv();
-                    tempTask->func(tempEvent->value, tempEvent->signal);
-                    if (taskFlag) {
-                        if (taskFlag & FLAG_CLOSE_MASK) {
-                            currExecTaskIndex = tempTask->next;
-                            __DeleteEventTask(tempTask);
-                            continue;
-                        } else if (taskFlag & FLAG_SUSPEND_MASK) {
-                            tempTask->info.eventbased.suspend = true;
-                        } else if (taskFlag & FLAG_DELAY_MASK) {
-                            tempTask->info.eventbased.nextRunTime = System_GetCurrTick() + (taskFlag & DELAY_TIME_MASK);
-                        }
-                    }
-                }
-                currExecTaskIndex = tempTask->next;
-            }
-            tempEvent->signal = 0;
-        }
-        eventQueue[0] = __EndOfEvtList;
-#endif
-        if (currTimeTaskIndex != __EndOfTaskList) {
-            if (System_GetCurrTick() >= taskList[currTimeTaskIndex].info.timebased.nextRunTime) {
-                currExecTaskIndex = currTimeTaskIndex;
-                tempTask          = taskList + currExecTaskIndex;
-                __ResetTaskExecuteEnv();
-                switch (tempTask->type) {
-                case TASKTYPE_CIRCULATE:
-                    tempTask->func(tempTask->info.timebased.count, tempTask->execState);
-                    currTimeTaskIndex = tempTask->next;
-                    if (taskFlag) {
-                        if (taskFlag & FLAG_CLOSE_MASK) {
-                            __ClearTaskNode(taskList + currExecTaskIndex);
-                            break;
-                        } else if (taskFlag & FLAG_SUSPEND_MASK) {
-                            break;
-                        } else if (taskFlag & FLAG_DELAY_MASK) {
-                            tempTask->info.timebased.nextRunTime += taskFlag & DELAY_TIME_MASK;
-                        }
-                    } else {
-                        tempTask->info.timebased.count++;
-                        tempTask->info.timebased.nextRunTime += tempTask->info.timebased.interval;
-                        tempTask->execState = 0;
-                    }
-                    __LinkTimebasedTaskNode(taskList + currExecTaskIndex);
-                    break;
-                case TASKTYPE_DISPOSABLE:
-                    tempTask->func(0, tempTask->execState);
-                    currTimeTaskIndex = tempTask->next;
-                    if (taskFlag & FLAG_DELAY_MASK) {
-                        tempTask->info.timebased.nextRunTime += taskFlag & DELAY_TIME_MASK;
-                        __LinkTimebasedTaskNode(taskList + currExecTaskIndex);
-                    } else {
-                        __ClearTaskNode(taskList + currExecTaskIndex);
-                    }
-                    break;
-                }
-            }
-#ifdef IDLE_HOOK_FUNCITON
-            else if (idleTask) {
-                u32 currIdleTick = System_GetCurrTick();
-                idleTask(currIdleTick, lastIdleTick);
-                lastIdleTick = currIdleTick;
-            }
-#endif
-        }
-#ifdef AUTO_SLEEP
-        else {
-            System_Sleep();
-        }
+    __LockScheduler();
+    bool ret = __SetTaskAffinity(task, core);
+    __UnlockScheduler();
+    return ret;
+}
 #endif
+
+#ifdef TASK_EDF
+static inline bool __SetTaskDeadline(Task *task, u32 deadline)
+{
+    if (__IsTaskParamInvalid(task)) {
+        return false;
+    }
+    if (task->ready) {
+        __UnlinkReadyTaskNode(task);
+        __TaskDeadline(task) = deadline;
+        __PushReadyTaskNode(task);
+    } else {
+        __TaskDeadline(task) = deadline;
     }
+    return true;
 }
 
-#ifdef IDLE_HOOK_FUNCITON
-void System_RegisterIdleTask(TaskMainFunc func)
+bool System_SetTaskDeadline(Task *task, u32 deadline)
 {
-    idleTask = func;
+    __LockScheduler();
+    bool ret = __SetTaskDeadline(task, deadline);
+    __UnlockScheduler();
+    return ret;
 }
 #endif
 
-void System_EndLoop(void)
+#ifdef TASK_PROFILE
+bool System_GetTaskProfile(Task *task, TaskProfile *profile)
 {
-    looping = false;
+    if (profile == NULL) {
+        return false;
+    }
+    __LockScheduler();
+    bool ret = !__IsTaskParamInvalid(task);
+    if (ret) {
+        *profile = taskProfile[task->curr];
+    }
+    __UnlockScheduler();
+    return ret;
 }
 
-Task *System_AddNewLoopTask(TaskMainFunc func, u32 interval)
+// busy percentage since the previous call, every call starts a new measuring window
+u8 System_GetCpuLoad(void)
 {
-    for (Task *t = taskList + TASK_MAX_NUM - 1; t >= taskList; --t) {
-        if (t->func == NULL) {
-            __InitTaskNode(t, TASKTYPE_CIRCULATE, func);
-            t->info.timebased.nextRunTime = System_GetCurrTick() + interval;
-            t->info.timebased.interval    = interval;
-            __LinkTimebasedTaskNode(t);
-            return t;
-        }
+    __LockScheduler();
+    u32 currTick    = System_GetCurrTick();
+    uint64_t window = currTick - loadStartTick;
+    uint64_t busy   = busyTicks;
+    busyTicks       = 0;
+    loadStartTick   = currTick;
+    __UnlockScheduler();
+#ifdef SMP_CORE_NUM
+    window *= SMP_CORE_NUM;
+#endif
+    if (window == 0) {
+        return 0;
     }
-    return NULL;
+    return busy >= window ? 100 : (u8)(busy * 100 / window);
 }
+#endif
 
-Task *System_AddNewTempTask(TaskMainFunc func, u32 interval)
+#ifdef TRACE_BUFFER
+u32 System_ReadTrace(TraceRecord *buffer, u32 size)
 {
-    for (Task *t = taskList + TASK_MAX_NUM - 1; t >= taskList; --t) {
-        if (t->func == NULL) {
-            __InitTaskNode(t, TASKTYPE_DISPOSABLE, func);
-            t->info.timebased.nextRunTime = System_GetCurrTick() + interval;
-            __LinkTimebasedTaskNode(t);
-            return t;
-        }
+    if (buffer == NULL) {
+        return 0;
+    }
+    __LockScheduler();
+    if (traceHead - traceTail > TRACE_BUFFER) {
+        traceTail = traceHead - TRACE_BUFFER; // overwritten before being read
     }
-    return NULL;
+    u32 num = 0;
+    while (num < size && traceTail != traceHead) {
+        buffer[num++] = traceRing[traceTail++ & TRACE_BUFFER_MASK];
+    }
+    __UnlockScheduler();
+    return num;
 }
+#endif
 
 #ifdef ENABLE_EVENT_TASK
-Task *System_AddNewEventTask(TaskMainFunc func, Event *event, u16 signal)
+#ifdef STATIC_TASK_TABLE
+Event *System_GetStaticEvent(u16 id)
 {
-    if (signal == 0 || __IsEventParamInvalid(event)) {
+    return id < EVENT_MAX_NUM ? eventList + id : NULL;
+}
+#else
+static inline Event *__CreateEvent(void)
+{
+    if (freeEvtIndex == __EndOfEvtList) {
         return NULL;
     }
-    for (Task *t = taskList + TASK_MAX_NUM - 1; t >= taskList; --t) {
-        if (t->func == NULL) {
-            __InitTaskNode(t, TASKTYPE_EVENT, func);
-            t->info.eventbased.event  = event;
-            t->info.eventbased.signal = signal;
+    Event *e     = eventList + freeEvtIndex;
+    freeEvtIndex = (EvtIndex)e->value;
+    e->enable    = true;
+    e->signal    = 0;
+    e->value     = 0;
+    e->subNum    = 0;
+#ifdef EVENT_MAILBOX
+    e->msgHead = 0;
+    e->msgSize = 0;
+#endif
+    return e;
+}
 
-            TaskIndex j = event->subList;
-            if (j == __EndOfTaskList) {
-                event->subList = t->curr;
-            } else {
-                while (taskList[j].next != __EndOfTaskList) {
-                    j = taskList[j].next;
-                }
-                taskList[j].next = t->curr;
-            }
-            return t;
-        }
-    }
-    return NULL;
+Event *System_CreateEvent(void)
+{
+    __LockScheduler();
+    Event *e = __CreateEvent();
+    __UnlockScheduler();
+    return e;
 }
-#endif
 
-bool System_SuspendTask(Task *task, u16 nextState)
+static inline bool __DeleteEvent(Event *event)
 {
-    if (__IsTaskParamInvalid(task) || task->type == TASKTYPE_DISPOSABLE) {
+    if (__IsEventParamInvalid(event) || event->subNum != 0) {
         return false;
     }
-    if (currExecTaskIndex == task->curr) {
-        taskFlag |= FLAG_SUSPEND_MASK;
-        return true;
-    }
-#ifdef ENABLE_EVENT_TASK
-    if (task->type == TASKTYPE_EVENT) {
-        task->info.eventbased.suspend = true;
-        return true;
+#ifdef PAYLOAD_NUM
+    for (EventMessage *mailbox = eventMailbox[event - eventList]; event->msgSize; --event->msgSize) {
+        __FreePayloadBlock(mailbox[event->msgHead].payload);
+        event->msgHead = event->msgHead + 1 < EVENT_MAILBOX ? event->msgHead + 1 : 0;
     }
+#elif defined(EVENT_MAILBOX)
+    event->msgSize = 0;
+#endif
+#ifdef EVENT_BUDGET
+    if (pausedEvent == event) {
+        pausedEvent = NULL; // nobody is left to receive the rest of it
+#ifdef PAYLOAD_NUM
+        __FreePayloadBlock(pausedMessage.payload);
 #endif
-    if (__SetNextNodeOfPrevTaskNode(task, currTimeTaskIndex)) {
-        return false;
     }
-    task->next      = __EndOfTaskList;
-    task->execState = nextState;
+#endif
+    event->enable = false;
+    event->value  = freeEvtIndex;
+    freeEvtIndex  = (EvtIndex)(event - eventList);
     return true;
 }
 
-bool System_ResumeTask(Task *task, u16 execState, bool instance)
+bool System_DeleteEvent(Event *event)
 {
-    if (__IsTaskParamInvalid(task) || task->type == TASKTYPE_DISPOSABLE) {
-        return false;
-    }
-#ifdef ENABLE_EVENT_TASK
-    if (task->type == TASKTYPE_EVENT) {
-        task->info.eventbased.suspend = false;
-        return true;
-    }
-#endif
-    task->execState                  = execState;
-    task->info.timebased.nextRunTime = System_GetCurrTick() + (instance ? 0 : task->info.timebased.interval);
-    __LinkTimebasedTaskNode(task);
-    return true;
+    __LockScheduler();
+    bool ret = __DeleteEvent(event);
+    __UnlockScheduler();
+    return ret;
 }
+#endif
 
-bool System_KillTask(Task *task)
+static inline bool __SetEvent(Event *event, u16 signal, u32 value)
 {
-    if (__IsTaskParamInvalid(task)) {
+#ifdef EVENT_MAILBOX
+    if (__IsEventParamInvalid(event) || signal == 0 || event->msgSize == EVENT_MAILBOX) {
         return false;
     }
-    if (currExecTaskIndex == task->curr) {
-        taskFlag |= FLAG_CLOSE_MASK;
-        return true;
+#else
+    if (__IsEventParamInvalid(event) || signal == 0 || (event->queued && event->signal == signal)) {
+        return false;
     }
-    switch (task->type) {
-    case TASKTYPE_CIRCULATE:
-    case TASKTYPE_DISPOSABLE: {
-        if (currTimeTaskIndex == __EndOfTaskList) {
-            return false;
-        }
-        if (__SetNextNodeOfPrevTaskNode(task, currTimeTaskIndex)) {
-            return false;
-        }
-        __ClearTaskNode(task);
-        return true;
+#endif
+    __TRACE(TRACE_EVENT_POST, event - eventList);
+#ifdef EVENT_MAILBOX
+    u32 tail = (u32)event->msgHead + event->msgSize;
+    if (tail >= EVENT_MAILBOX) {
+        tail -= EVENT_MAILBOX;
     }
-#ifdef ENABLE_EVENT_TASK
-    case TASKTYPE_EVENT:
-        if (task->info.eventbased.event->subList == __EndOfTaskList) {
-            return false;
-        }
-        __DeleteEventTask(task);
-        return true;
+    EventMessage *message = eventMailbox[event - eventList] + tail;
+    message->signal       = signal;
+    message->value        = value;
+#ifdef PAYLOAD_NUM
+    message->payload = __EndOfPayload;
 #endif
-    default:
-        return false;
+    ++event->msgSize;
+#else
+    event->signal = signal;
+    event->value  = value;
+#endif
+    if (event->queued == false) {
+        u32 tail = (u32)evtQueueHead + evtQueueSize;
+        if (tail >= EVENT_MAX_NUM) {
+            tail -= EVENT_MAX_NUM;
+        }
+        eventQueue[tail] = (EvtIndex)(event - eventList);
+        event->queued    = true;
+        ++evtQueueSize;
     }
+    return true;
 }
 
-#ifdef ENABLE_EVENT_TASK
-Event *System_CreateEvent(void)
+bool System_SetEvent(Event *event, u16 signal, u32 value)
 {
-    for (EvtIndex i = 0; i < EVENT_MAX_NUM; ++i) {
-        if (eventList[i].enable == false) {
-            eventList[i].enable  = true;
-            eventList[i].signal  = 0;
-            eventList[i].value   = 0;
-            eventList[i].subList = __EndOfTaskList;
-            return eventList + i;
-        }
+    __LockScheduler();
+    bool ret = __SetEvent(event, signal, value);
+    __UnlockScheduler();
+    return ret;
+}
+
+#ifdef PAYLOAD_NUM
+void *System_AllocPayload(void)
+{
+    void *payload = NULL;
+    __LockScheduler();
+    if (freePayloadIndex != __EndOfPayload) {
+        payload          = payloadPool + freePayloadIndex;
+        freePayloadIndex = payloadPool[freePayloadIndex].next;
     }
-    return NULL;
+    __UnlockScheduler();
+    return payload;
 }
 
-bool System_DeleteEvent(Event *event)
+bool System_FreePayload(void *payload)
 {
-    if (__IsEventParamInvalid(event) || event->subList != __EndOfTaskList) {
+    if (__IsPayloadParamInvalid(payload)) {
         return false;
     }
-    event->enable = false;
+    __LockScheduler();
+    __FreePayloadBlock((PayloadIndex)((PayloadBlock *)payload - payloadPool));
+    __UnlockScheduler();
     return true;
 }
 
-bool System_SetEvent(Event *event, u16 signal, u32 value)
+// the payload is owned by the kernel after a successful post and released once every subscriber has returned
+static inline bool __PostEvent(Event *event, u16 signal, u32 value, void *payload)
 {
-    if (__IsEventParamInvalid(event) || signal == 0 || event->signal == signal) {
+    if (payload != NULL && __IsPayloadParamInvalid(payload)) {
         return false;
     }
-    event->signal = signal;
-    event->value  = value;
-    for (EvtIndex i = 0; i < EVENT_MAX_NUM; ++i) {
-        if (eventList + eventQueue[i] == event) {
-            return true;
+    if (__SetEvent(event, signal, value) == false) {
+        return false;
+    }
+    if (payload != NULL) {
+        u32 tail = (u32)event->msgHead + event->msgSize - 1;
+        if (tail >= EVENT_MAILBOX) {
+            tail -= EVENT_MAILBOX;
         }
-        if (eventQueue[i] == __EndOfEvtList) {
-            eventQueue[i] = (EvtIndex)(event - eventList);
-            if (i + 1 < EVENT_MAX_NUM) {
-                eventQueue[i + 1] = __EndOfEvtList;
+        eventMailbox[event - eventList][tail].payload = (PayloadIndex)((PayloadBlock *)payload - payloadPool);
+    }
+    return true;
+}
+
+bool System_PostEvent(Event *event, u16 signal, u32 value, void *payload)
+{
+    __LockScheduler();
+    bool ret = __PostEvent(event, signal, value, payload);
+    __UnlockScheduler();
+    return ret;
+}
+#endif
+
+#ifdef ISR_EVENT_QUEUE
+bool System_SetEventFromISR(Event *event, u16 signal, u32 value)
+{
+    if (event == NULL || event < eventList || event > eventList + EVENT_MAX_NUM - 1 || signal == 0) {
+        return false;
+    }
+    IsrEventCell *cell;
+    u32 pos = atomic_load_explicit(&isrQueueTail, memory_order_relaxed);
+    for (;;) {
+        cell         = isrQueue + (pos & ISR_QUEUE_MASK);
+        u32 seq      = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&isrQueueTail, &pos, pos + 1U, memory_order_relaxed, memory_order_relaxed)) {
+                break;
             }
-            return true;
+        } else if ((s32)(seq - pos) < 0) {
+            return false; // full
+        } else {
+            pos = atomic_load_explicit(&isrQueueTail, memory_order_relaxed);
         }
     }
-    return false;
+    cell->event  = (EvtIndex)(event - eventList);
+    cell->signal = signal;
+    cell->value  = value;
+    atomic_store_explicit(&cell->seq, pos + 1U, memory_order_release);
+#ifdef TICKLESS_IDLE
+    System_Wakeup();
+#endif
+    return true;
+}
+
+u32 System_GetIsrDropCount(void)
+{
+    __LockScheduler();
+    u32 ret = isrDropNum;
+    __UnlockScheduler();
+    return ret;
+}
+#endif
+
+bool System_IsEventValid(Event *event)
+{
+    __LockScheduler();
+    bool ret = !__IsEventParamInvalid(event);
+    __UnlockScheduler();
+    return ret;
+}
+
+// reads no event state, so any thread may call it
+bool System_IsEventHandle(Event *event)
+{
+    return event != NULL && event >= eventList && event <= eventList + EVENT_MAX_NUM - 1;
 }
 
 u16 System_GetEventSignal(Event *event)
 {
+#ifdef EVENT_MAILBOX
+    return event->msgSize ? eventMailbox[event - eventList][event->msgHead].signal : 0;
+#else
     return event->signal;
+#endif
+}
+
+#ifdef EVENT_BUDGET
+bool System_GetEventBudgetStats(EventBudgetStats *stats)
+{
+    if (stats == NULL) {
+        return false;
+    }
+    __LockScheduler();
+    *stats = budgetStats;
+    __UnlockScheduler();
+    return true;
 }
 #endif
+#endif
 
 bool Task_Yield(u16 nextState)
 {
     if (currExecTaskIndex == __EndOfTaskList
 #ifdef ENABLE_EVENT_TASK
-        || taskList[currExecTaskIndex].type == TASKTYPE_EVENT
+        || __TaskType(taskList + currExecTaskIndex) == TASKTYPE_EVENT
 #endif
     ) {
         return false;
     }
-    taskFlag &= ~DELAY_TIME_MASK;
+    taskFlag &= ~FLAG_UNTIL_MASK;
     taskFlag |= FLAG_DELAY_MASK;
-    taskList[currExecTaskIndex].info.timebased.nextRunTime = System_GetCurrTick();
-    taskList[currExecTaskIndex].execState                  = nextState;
+    taskDelay = 0;
+    __TaskRunTime(taskList + currExecTaskIndex) = System_GetCurrTick();
+    taskList[currExecTaskIndex].execState       = nextState;
     return true;
 }
 
-bool Task_Delay(u16 ticks, u16 nextState)
+bool Task_Delay(u32 ticks, u16 nextState)
 {
-    if (currExecTaskIndex == __EndOfTaskList) {
+    if (currExecTaskIndex == __EndOfTaskList || ticks > 0x7FFFFFFFU) {
         return false;
     }
-    taskFlag |= (ticks & DELAY_TIME_MASK);
+    taskFlag &= ~FLAG_UNTIL_MASK;
     taskFlag |= FLAG_DELAY_MASK;
+    taskDelay = ticks;
+    taskList[currExecTaskIndex].execState = nextState;
+    return true;
+}
+
+bool Task_DelayUntil(u32 tick, u16 nextState)
+{
+    if (currExecTaskIndex == __EndOfTaskList) {
+        return false;
+    }
+    u32 currTick = System_GetCurrTick();
+    taskFlag |= FLAG_DELAY_MASK | FLAG_UNTIL_MASK;
+    taskDelay = (s32)(tick - currTick) < 0 ? currTick : tick; // a tick already passed runs at once
     taskList[currExecTaskIndex].execState = nextState;
     return true;
 }
 
 bool Task_Suspend(u16 nextState)
 {
-    if (currExecTaskIndex == __EndOfTaskList || taskList[currExecTaskIndex].type == TASKTYPE_DISPOSABLE || nextState) {
+    if (currExecTaskIndex == __EndOfTaskList || __TaskType(taskList + currExecTaskIndex) == TASKTYPE_DISPOSABLE || nextState) {
         return false;
     }
     taskFlag |= FLAG_SUSPEND_MASK;
@@ -526,17 +2866,80 @@ bool Task_Suspend(u16 nextState)
 }
 
 #ifdef ENABLE_EVENT_TASK
+static inline bool __ListenSingal(u16 newSignal)
+{
+    if (currExecTaskIndex == __EndOfTaskList || __TaskType(taskList + currExecTaskIndex) != TASKTYPE_EVENT || newSignal == 0) {
+        return false;
+    }
+    Task *task = taskList + currExecTaskIndex;
+    if (task->info.eventbased.signal == newSignal) {
+        return true;
+    }
+    __UnlinkEventTaskNode(task);
+    task->info.eventbased.signal = newSignal;
+    __LinkEventTaskNode(task);
+    return true;
+}
+
 bool Task_ListenSingal(u16 newSignal)
 {
-    if (currExecTaskIndex == __EndOfTaskList || taskList[currExecTaskIndex].type != TASKTYPE_EVENT || newSignal == 0) {
+    __LockScheduler();
+    bool ret = __ListenSingal(newSignal);
+    __UnlockScheduler();
+    return ret;
+}
+
+#ifndef STATIC_TASK_TABLE
+static inline bool __ListenEvent(Event *event, u16 newSignal)
+{
+    if (currExecTaskIndex == __EndOfTaskList || __TaskType(taskList + currExecTaskIndex) != TASKTYPE_EVENT || newSignal == 0 || __IsEventParamInvalid(event)) {
         return false;
     }
-    taskList[currExecTaskIndex].info.eventbased.signal = newSignal;
+    Task *task = taskList + currExecTaskIndex;
+    if (__TaskEvent(task) == event && task->info.eventbased.signal == newSignal) {
+        return true;
+    }
+    __UnlinkEventTaskNode(task);
+    __TaskEvent(task)->subNum--;
+    task->info.eventbased.event  = (EvtIndex)(event - eventList);
+    task->info.eventbased.signal = newSignal;
+    event->subNum++;
+    __LinkEventTaskNode(task);
     return true;
 }
+
+bool Task_ListenEvent(Event *event, u16 newSignal)
+{
+    __LockScheduler();
+    bool ret = __ListenEvent(event, newSignal);
+    __UnlockScheduler();
+    return ret;
+}
 #endif
+#endif
+
+u16 Task_GetState(void)
+{
+    return currExecTaskIndex == __EndOfTaskList ? 0 : taskList[currExecTaskIndex].execState;
+}
+
+bool Task_SetState(u16 nextState)
+{
+    if (currExecTaskIndex == __EndOfTaskList) {
+        return false;
+    }
+    taskList[currExecTaskIndex].execState = nextState;
+    return true;
+}
 
 void Task_Close(void)
 {
     taskFlag |= FLAG_CLOSE_MASK;
-}
\ No newline at end of file
+}
+
+#ifdef PAYLOAD_NUM
+void *Task_GetPayload(void)
+{
+    return currPayload;
+}
+#endif
\ No newline at end of file
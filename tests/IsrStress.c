@@ -0,0 +1,177 @@
+/**
+ * @brief   Multi-producer stress check of the ISR event queue behind System_SetEventFromISR.
+ *
+ *          STRESS_PRODUCER_NUM threads post STRESS_POST_NUM messages each to their own event, while System_Loop drains
+ *          the queue on the main thread. The value of a post holds the producer and its sequence number, and the signal
+ *          is derived from the value, so the event task can tell a lost, duplicated, reordered or torn message. A producer
+ *          retries a post the queue rejects as full, and never has more messages in flight than its event can hold
+ *          (EVENT_MAILBOX, or a single pending signal), so every accepted post must be delivered exactly once and in
+ *          order, and System_GetIsrDropCount must stay 0. Prints one CSV row and exits with 1 on any error:
+ *
+ *            producers,posts,queue_full,delivered,lost,duplicated,reordered,torn,dropped,ms
+ *
+ *          Built and registered with CTest by tests/CMakeLists.txt, or by hand:
+ *
+ *            cc -O2 -DISR_EVENT_QUEUE=16 -DIDLE_HOOK_FUNCITON -DEVENT_MAX_NUM=4 -DTASK_MAX_NUM=12 -Iinc \
+ *               tests/IsrStress.c src/SystemCore.c -lpthread
+ **/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SystemCore.h"
+
+#if !defined(ISR_EVENT_QUEUE) || !defined(IDLE_HOOK_FUNCITON)
+#error "The stress check needs 'ISR_EVENT_QUEUE' and 'IDLE_HOOK_FUNCITON'!"
+#endif
+#ifdef EVENT_MAILBOX
+#define STRESS_IN_FLIGHT EVENT_MAILBOX
+#else
+#define STRESS_IN_FLIGHT 1 // a second post would merge with the pending signal
+#endif
+#ifndef STRESS_PRODUCER_NUM
+#define STRESS_PRODUCER_NUM EVENT_MAX_NUM
+#endif
+#ifndef STRESS_POST_NUM
+#define STRESS_POST_NUM 200000
+#endif
+#define STRESS_SIGNAL_NUM 3
+#define __SignalOf(value) ((u16)((value) % STRESS_SIGNAL_NUM + 1U))
+#define __ValueOf(id, seq) ((u32)(id) << 24 | (seq))
+
+typedef struct Producer {
+    pthread_t thread;
+    u32 id;
+    Event *event;
+    u32 posted;               // written by the producer only
+    _Atomic u32 delivered;    // written by the event task only
+    u32 expected;             // next sequence number the event task waits for
+    u32 lost, duplicated, reordered;
+    _Atomic u32 full;
+} Producer;
+
+static Producer producers[STRESS_PRODUCER_NUM];
+static u32 postNum = STRESS_POST_NUM;
+static _Atomic u32 finishedNum;
+static u32 tornNum; // value of an unknown producer or a signal that does not match the value
+
+u32 System_GetCurrTick(void)
+{
+    return 0; // only event tasks run
+}
+
+static void *__ProducerMain(void *arg)
+{
+    Producer *producer = arg;
+    for (u32 seq = 0; seq < postNum;) {
+        if (seq - atomic_load_explicit(&producer->delivered, memory_order_acquire) >= STRESS_IN_FLIGHT) {
+            sched_yield(); // the event could not hold another message
+            continue;
+        }
+        u32 value = __ValueOf(producer->id, seq);
+        if (System_SetEventFromISR(producer->event, __SignalOf(value), value) == false) {
+            atomic_fetch_add_explicit(&producer->full, 1, memory_order_relaxed);
+            sched_yield();
+            continue;
+        }
+        producer->posted = ++seq;
+    }
+    atomic_fetch_add_explicit(&finishedNum, 1, memory_order_release);
+    return NULL;
+}
+
+static void __ConsumerTask(u32 value, u16 signal)
+{
+    u32 id = value >> 24, seq = value & 0xFFFFFFU;
+    if (id >= STRESS_PRODUCER_NUM || signal != __SignalOf(value)) {
+        ++tornNum;
+        return;
+    }
+    Producer *producer = producers + id;
+    if (seq == producer->expected) {
+        ++producer->expected;
+    } else if (seq < producer->expected) {
+        ++producer->duplicated;
+    } else {
+        producer->lost += seq - producer->expected;
+        ++producer->reordered;
+        producer->expected = seq + 1;
+    }
+    atomic_store_explicit(&producer->delivered, producer->expected, memory_order_release);
+}
+
+static inline int64_t __GetNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void __IdleTask(u32 currIdleTick, u16 lastIdleTick)
+{
+    static int64_t drainNs; // when the last producer finished
+    (void)currIdleTick;
+    (void)lastIdleTick;
+    if (atomic_load_explicit(&finishedNum, memory_order_acquire) < STRESS_PRODUCER_NUM) {
+        return;
+    }
+    if (drainNs == 0) {
+        drainNs = __GetNs();
+    }
+    for (u32 i = 0; i < STRESS_PRODUCER_NUM; ++i) {
+        if (atomic_load_explicit(&producers[i].delivered, memory_order_relaxed) < producers[i].posted &&
+            __GetNs() - drainNs < 1000000000LL) {
+            return; // a post may still be in the ISR queue, a lost one ends the run after 1 s
+        }
+    }
+    System_EndLoop();
+}
+
+int main(int argc, char *argv[])
+{
+    const char *posts = getenv("STRESS_POSTS");
+    if (posts && atoi(posts) > 0 && atoi(posts) <= 0xFFFFFF) {
+        postNum = (u32)atoi(posts);
+    }
+    (void)argv;
+    System_Init();
+    for (u32 i = 0; i < STRESS_PRODUCER_NUM; ++i) {
+        producers[i].id    = i;
+        producers[i].event = System_CreateEvent();
+        for (u16 signal = 1; signal <= STRESS_SIGNAL_NUM; ++signal) {
+            if (System_AddNewEventTask(__ConsumerTask, producers[i].event, signal) == NULL) {
+                fprintf(stderr, "TASK_MAX_NUM must be at least %u\n", STRESS_SIGNAL_NUM * STRESS_PRODUCER_NUM);
+                return 1;
+            }
+        }
+    }
+    System_RegisterIdleTask(__IdleTask);
+    int64_t startNs = __GetNs();
+    for (u32 i = 0; i < STRESS_PRODUCER_NUM; ++i) {
+        pthread_create(&producers[i].thread, NULL, __ProducerMain, producers + i);
+    }
+    System_Loop();
+    for (u32 i = 0; i < STRESS_PRODUCER_NUM; ++i) {
+        pthread_join(producers[i].thread, NULL);
+    }
+    u32 full = 0, delivered = 0, lost = 0, duplicated = 0, reordered = 0, torn = tornNum, dropped = System_GetIsrDropCount();
+    for (u32 i = 0; i < STRESS_PRODUCER_NUM; ++i) {
+        Producer *producer = producers + i;
+        full += producer->full;
+        delivered += producer->expected;
+        lost += producer->lost + (producer->posted - producer->expected);
+        duplicated += producer->duplicated;
+        reordered += producer->reordered;
+    }
+    if (argc > 1) { // any argument prints the CSV header first
+        printf("producers,posts,queue_full,delivered,lost,duplicated,reordered,torn,dropped,ms\n");
+    }
+    printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f\n", (unsigned)STRESS_PRODUCER_NUM, (unsigned)(postNum * STRESS_PRODUCER_NUM), full, delivered,
+           lost, duplicated, reordered, torn, dropped, (double)(__GetNs() - startNs) / 1e6);
+    return lost || duplicated || reordered || torn || dropped || delivered != postNum * STRESS_PRODUCER_NUM;
+}
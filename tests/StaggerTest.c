@@ -0,0 +1,75 @@
+/**
+ * @brief   Check that TASK_STAGGER follows a periodic task whose phase changes.
+ *
+ *          Runs on VIRTUAL_TIME with a window of 4 ticks and periods of 4, so every task loads exactly one slot of the
+ *          window. Fillers take slots 0 and 2, and a task A created on slot 1 moves itself to slot 3 with Task_Delay.
+ *          A probe added by System_AddNewLoopTask must then land on slot 1, the one A left. A is then suspended and
+ *          resumed onto slot 1, and the next probe must land on slot 3. Prints one line per check and exits with 1
+ *          on any mismatch.
+ *
+ *          Built and registered with CTest by tests/CMakeLists.txt, or by hand:
+ *
+ *            cc -O2 -DVIRTUAL_TIME -DTASK_STAGGER=4 -DEVENT_MAX_NUM=0 -DTASK_MAX_NUM=8 -Iinc \
+ *               tests/StaggerTest.c src/SystemCore.c
+ **/
+#include <stdio.h>
+
+#include "SystemCore.h"
+
+#if !defined(VIRTUAL_TIME) || !defined(TASK_STAGGER) || TASK_STAGGER != 4
+#error "The stagger check needs 'VIRTUAL_TIME' and a 'TASK_STAGGER' window of 4!"
+#endif
+
+static u32 probeTick;
+static u32 failNum;
+
+static void __FillerTask(u32 count, u16 state)
+{
+    (void)count;
+    (void)state;
+}
+
+static void __PhaseTask(u32 count, u16 state)
+{
+    if (count == 0 && state == 0) {
+        Task_Delay(2, 1); // due at 3 instead of 5, the phase moves from slot 1 to slot 3
+    }
+}
+
+static void __ProbeTask(u32 count, u16 state)
+{
+    (void)state;
+    if (count == 0) {
+        probeTick = System_GetCurrTick();
+    }
+}
+
+static void __Check(const char *name, u32 tick, u32 expected)
+{
+    printf("%s: first run at %u, expected %u\n", name, tick, expected);
+    failNum += tick != expected;
+}
+
+int main(void)
+{
+    System_Init();
+    System_AddNewLoopTaskAt(__FillerTask, 4, 4);
+    System_AddNewLoopTaskAt(__FillerTask, 4, 2);
+    Task *phase = System_AddNewLoopTaskAt(__PhaseTask, 4, 1);
+
+    // slots 0 and 2 are taken, A left slot 1 for slot 3, so the probe added at 2 must run at 5
+    System_RunUntil(2);
+    Task *probe = System_AddNewLoopTask(__ProbeTask, 4);
+    System_RunUntil(6);
+    __Check("delay", probeTick, 5);
+
+    // A leaves slot 3 while suspended and comes back at 13, slot 1, so the probe added at 9 must run at 11
+    System_KillTask(probe);
+    System_SuspendTask(phase, 0);
+    System_RunUntil(9);
+    System_ResumeTask(phase, 0, false);
+    System_AddNewLoopTask(__ProbeTask, 4);
+    System_RunUntil(20);
+    __Check("resume", probeTick, 11);
+    return failNum != 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @brief   Converts records read by System_ReadTrace() into Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ *   Build: cc -O2 TraceToJson.c -o TraceToJson
+ *   Usage: TraceToJson [-t microseconds per tick] [input.bin] > trace.json
+ *
+ *   The input is the raw TraceRecord array as dumped from the target, 8 bytes per record in little-endian:
+ *   u32 tick, u16 index, u8 type, u8 core. Each core becomes one thread of the timeline.
+ **/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    TRACE_TASK_START,
+    TRACE_TASK_END,
+    TRACE_EVENT_POST,
+    TRACE_EVENT_DISPATCH,
+    TRACE_TASK_SUSPEND,
+    TRACE_TASK_RESUME,
+    TRACE_TASK_KILL,
+    TRACE_IDLE_ENTER,
+    TRACE_IDLE_EXIT,
+};
+
+static const char *const instantName[] = {
+    [TRACE_EVENT_POST]     = "post event",
+    [TRACE_EVENT_DISPATCH] = "dispatch event",
+    [TRACE_TASK_SUSPEND]   = "suspend task",
+    [TRACE_TASK_RESUME]    = "resume task",
+    [TRACE_TASK_KILL]      = "kill task",
+};
+
+int main(int argc, char *argv[])
+{
+    double tickUs = 1000.0;
+    FILE *input   = stdin;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tickUs = atof(argv[++i]);
+        } else if ((input = fopen(argv[i], "rb")) == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+    }
+
+    uint8_t raw[8];
+    uint32_t firstTick = 0, lastTick = 0;
+    unsigned long num = 0;
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"MinSys\"}}");
+    while (fread(raw, sizeof(raw), 1, input) == 1) {
+        uint32_t tick  = raw[0] | (uint32_t)raw[1] << 8 | (uint32_t)raw[2] << 16 | (uint32_t)raw[3] << 24;
+        uint16_t index = (uint16_t)(raw[4] | raw[5] << 8);
+        uint8_t type   = raw[6];
+        uint8_t core   = raw[7];
+        if (num++ == 0) {
+            firstTick = tick;
+        }
+        lastTick  = tick;
+        double ts = (double)(uint32_t)(tick - firstTick) * tickUs; // relative, survives tick wrap-around
+        switch (type) {
+        case TRACE_TASK_START:
+        case TRACE_TASK_END:
+            printf(",\n{\"name\":\"task %u\",\"cat\":\"task\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", index, type == TRACE_TASK_START ? 'B' : 'E', ts, core);
+            break;
+        case TRACE_IDLE_ENTER:
+        case TRACE_IDLE_EXIT:
+            printf(",\n{\"name\":\"idle\",\"cat\":\"idle\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", type == TRACE_IDLE_ENTER ? 'B' : 'E', ts, core);
+            break;
+        case TRACE_EVENT_POST:
+        case TRACE_EVENT_DISPATCH:
+        case TRACE_TASK_SUSPEND:
+        case TRACE_TASK_RESUME:
+        case TRACE_TASK_KILL:
+            printf(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"%s\":%u}}", instantName[type],
+                   type <= TRACE_EVENT_DISPATCH ? "event" : "task", ts, core, type <= TRACE_EVENT_DISPATCH ? "event" : "task", index);
+            break;
+        default:
+            fprintf(stderr, "record %lu: unknown type %u\n", num - 1, type);
+            break;
+        }
+    }
+    printf("\n]}\n");
+    fprintf(stderr, "%lu records, ticks %u ~ %u\n", num, firstTick, lastTick);
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}